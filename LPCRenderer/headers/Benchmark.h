@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+
+class PointCloud;
+
+namespace Benchmark
+{
+	std::unique_ptr<PointCloud> generateSyntheticCloud(std::size_t pointCount, bool withNormals, bool withColors);
+	void drawUI();
+}
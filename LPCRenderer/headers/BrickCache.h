@@ -0,0 +1,17 @@
+#pragma once
+#include "PointCloud.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+//versioned on-disk format of an already bricked point cloud
+//loading only reads the header, the points are memory mapped and paged in on first access
+//packed renderer streams the cloud has built so far are stored alongside and uploaded without repacking
+namespace BrickCache
+{
+	inline std::string const extension = ".lpc";
+
+	bool save(PointCloud const& cloud, std::filesystem::path const& filename);
+	std::unique_ptr<PointCloud> load(std::filesystem::path const& filename);
+};
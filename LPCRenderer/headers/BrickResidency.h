@@ -0,0 +1,104 @@
+#pragma once
+#include "GPUBuffer.h"
+#include "PointCloud.h"
+#include "ThreadPool.h"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+//streams the bricks of a cloud through a bounded host cache into a fixed size GPU page pool,
+//so clouds larger than RAM or VRAM can be drawn straight from a memory mapped brick cache
+class BrickResidency
+{
+public:
+	static constexpr std::size_t streamCount = 3;
+	static constexpr std::size_t pagePointCount = 4096;
+	//bytes per point of every attribute stream, 0 for streams that are not used
+	using StreamLayout = std::array<std::size_t, streamCount>;
+	//packed attributes of one brick, laid out like the GPU pool
+	using BrickPayload = std::array<std::vector<std::byte>, streamCount>;
+	using Packer = std::function<BrickPayload(PointCloudBrick const&)>;
+
+	struct Budgets
+	{
+		std::size_t hostBytes = 0;
+		std::size_t gpuBytes = 0;
+		//caps the uploads of one frame so paging in does not stall rendering
+		std::size_t uploadBytesPerFrame = 0;
+	};
+
+private:
+	struct HostBrick
+	{
+		BrickPayload payload;
+		std::size_t size = 0;
+		std::list<std::size_t>::iterator lruPosition;
+	};
+
+	struct PendingLoad
+	{
+		std::future<void> done;
+		std::shared_ptr<BrickPayload> payload;
+	};
+
+	struct GPUBrick
+	{
+		std::vector<std::size_t> pages;
+		std::size_t lastUsedFrame = 0;
+	};
+
+	PointCloud const* cloud;
+	StreamLayout layout;
+	Packer packer;
+	Budgets budgets;
+	std::size_t pageCount = 0;
+	std::array<GPUBuffer, streamCount> pools{GPUBuffer{GL_ARRAY_BUFFER}, GPUBuffer{GL_ARRAY_BUFFER}, GPUBuffer{GL_ARRAY_BUFFER}};
+	//uploads are packed into the mapped staging ring and copied into the pools on the gpu
+	GPUBuffer stagingBuffer{GL_COPY_READ_BUFFER};
+	GPUBuffer drawBuffer{GL_DRAW_INDIRECT_BUFFER};
+	std::size_t drawOffset = 0;
+	std::size_t drawCount = 0;
+	std::vector<std::size_t> freePages;
+	std::unordered_map<std::size_t, GPUBrick> gpuBricks;
+	std::unordered_map<std::size_t, HostBrick> hostBricks;
+	//most recently used first
+	std::list<std::size_t> hostLRU;
+	std::size_t hostBytes = 0;
+	std::unordered_map<std::size_t, PendingLoad> pendingLoads;
+	std::size_t frame = 0;
+	//declared last so that queued loads finish before anything they touch is destroyed
+	ThreadPool loaders{2};
+
+public:
+	BrickResidency(PointCloud const* cloud, StreamLayout layout, Packer packer, Budgets budgets);
+	BrickResidency(BrickResidency const&) = delete;
+	BrickResidency(BrickResidency&&) = delete;
+	~BrickResidency();
+	BrickResidency& operator=(BrickResidency const&) = delete;
+	BrickResidency& operator=(BrickResidency&&) = delete;
+
+private:
+	std::size_t getPageCount(std::size_t brickIndex) const;
+	std::size_t requestLoad(std::size_t brickIndex);
+	void collectLoads();
+	std::size_t insertHostBrick(std::size_t brickIndex, BrickPayload&& payload);
+	HostBrick* findHostBrick(std::size_t brickIndex);
+	bool upload(std::size_t brickIndex, HostBrick const& hostBrick);
+
+public:
+	//pages in the visible bricks closest to the camera, cameraPosition is in model space
+	void update(glm::mat4 const& modelViewProjection, glm::vec3 cameraPosition);
+	GPUBuffer const& getStream(std::size_t stream) const;
+	GPUBuffer const& getDrawBuffer() const;
+	//byte offset of this frame's draw commands in the draw buffer
+	std::size_t getDrawOffset() const;
+	std::size_t getDrawCount() const;
+	std::size_t getResidentBrickCount() const;
+	std::size_t getPendingLoadCount() const;
+};
@@ -0,0 +1,17 @@
+#pragma once
+#include "Span.h"
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//bc1 like blocks of consecutive points, two rgb565 endpoints in the first word followed by an index per point
+//into the colours interpolated between them, indexBits words per block, so 1 + indexBits bits per point
+constexpr std::size_t colorBlockSize = 32;
+
+std::size_t getColorBlockWords(int indexBits);
+std::vector<std::uint32_t> toColorBlocks(Span<glm::u8vec3 const> colors, int indexBits);
+glm::u8vec3 fromColorBlocks(Span<std::uint32_t const> blocks, std::size_t point, int indexBits);
+//peak signal to noise ratio in dB over all channels of all points
+float getColorPSNR(Span<glm::u8vec3 const> colors, Span<std::uint32_t const> blocks, int indexBits);
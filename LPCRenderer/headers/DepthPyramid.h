@@ -0,0 +1,31 @@
+#pragma once
+#include "glm/glm.hpp"
+
+//max reduced copies of the depth buffer, every texel holds the farthest depth of the pixels below it
+//so a box whose nearest depth lies behind that value is hidden for sure
+class DepthPyramid
+{
+private:
+	unsigned int depthTexture = 0;
+	unsigned int pyramidTexture = 0;
+	glm::ivec2 size{0};
+	int levelCount = 0;
+
+public:
+	DepthPyramid() = default;
+	DepthPyramid(DepthPyramid const&) = delete;
+	DepthPyramid(DepthPyramid&& other);
+	~DepthPyramid();
+	DepthPyramid& operator=(DepthPyramid const&) = delete;
+	DepthPyramid& operator=(DepthPyramid&& other);
+
+private:
+	void free();
+	void allocate(glm::ivec2 size);
+
+public:
+	//copies the depth buffer of the bound framebuffer and reduces it, level 0 has half its resolution
+	void build();
+	void bind(unsigned int unit) const;
+	int getLevelCount() const;
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include "glm/glm.hpp"
+
+#include <array>
+#include <utility>
+
+//conservative test, boxes that straddle a frustum corner may be kept although they are not visible
+inline bool isOutsideFrustum(glm::mat4 const& modelViewProjection, std::pair<glm::vec3, glm::vec3> const& bounds)
+{
+	std::array<glm::vec4, 8> corners;
+	for(int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner{
+			i & 1 ? bounds.second.x : bounds.first.x,
+			i & 2 ? bounds.second.y : bounds.first.y,
+			i & 4 ? bounds.second.z : bounds.first.z
+		};
+		corners[i] = modelViewProjection * glm::vec4(corner, 1.0f);
+	}
+	//outside as soon as all corners lie beyond the same clip plane
+	for(int axis = 0; axis < 3; axis++)
+	{
+		bool allBelow = true;
+		bool allAbove = true;
+		for(auto const& corner : corners)
+		{
+			allBelow = allBelow && corner[axis] < -corner.w;
+			allAbove = allAbove && corner[axis] > corner.w;
+		}
+		if(allBelow || allAbove)
+			return true;
+	}
+	return false;
+}
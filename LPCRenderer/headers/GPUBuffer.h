@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <tuple>
+#include <optional>
 #include <glad/glad.h>
 
 
@@ -10,6 +11,12 @@ private:
 	unsigned int ID = 0;
 	GLenum target;
 	std::size_t currentSize = 0;
+	//streaming buffers only, see reserveStreaming
+	std::byte* mapping = nullptr;
+	std::size_t regionSize = 0;
+	std::vector<GLsync> fences;
+	std::size_t currentRegion = 0;
+	std::size_t head = 0;
 
 public:
 	GPUBuffer(GLenum target);
@@ -24,10 +31,25 @@ public:
 	void free();
 	void clear();
 	void write(std::vector<std::pair<std::byte const*, std::size_t>>&& data);
-	void reserve(std::size_t size);
+	void reserve(std::size_t size, GLbitfield flags = 0);
+	void update(std::size_t offset, std::byte const* data, std::size_t size);
+	void read(std::size_t offset, std::byte* data, std::size_t size) const;
+	void copy(GPUBuffer const& source, std::size_t sourceOffset, std::size_t offset, std::size_t size);
+	//persistently mapped coherent storage of regionCount regions that are cycled through once per frame,
+	//a fence per region keeps the cpu from overwriting data the gpu may still read,
+	//with GL_MAP_READ_BIT the gpu writes a region and the cpu reads it once the region comes round again
+	void reserveStreaming(std::size_t regionSize, std::size_t regionCount = 3, GLbitfield access = GL_MAP_WRITE_BIT);
+	//fences everything written so far and moves on to the next region, waits if the gpu still reads it
+	void advanceRegion();
+	//offset of size free bytes in the current region, empty once the region is full
+	std::optional<std::size_t> allocate(std::size_t size, std::size_t alignment = 4);
+	//producers can pack their data straight into an allocated range
+	std::byte* map(std::size_t offset) const;
+	void writeMapped(std::size_t offset, std::byte const* data, std::size_t size);
 	void bind() const;
 	void bind(GLenum target) const;
 	void bindBase(unsigned int base) const;
+	void bindBase(GLenum target, unsigned int base) const;
 };
 
 template<typename T>
@@ -44,4 +66,6 @@ struct DrawCommand
 	unsigned int baseInstance = 0;
 };
 
-void drawMemoryConsumption(std::size_t amountInBytes);
\ No newline at end of file
+void drawMemoryConsumption(std::size_t amountInBytes);
+//largest buffer a shader can index as one storage block, streams beyond it have to stay vertex attributes
+std::size_t getMaxShaderStorageBlockSize();
\ No newline at end of file
@@ -1,8 +1,13 @@
 #pragma once
 
 #include <filesystem>
+#include <vector>
 
 namespace Importer
 {
+	//queues the files to be loaded in the background
 	void import(std::vector<std::filesystem::path> const& filenames);
+	//hands finished imports to the managers, has to be called from the main thread
+	void update();
+	void drawUI();
 };
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+
+//read-only memory mapping of a whole file
+class MappedFile
+{
+private:
+	std::byte const* first = nullptr;
+	std::size_t length = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+
+public:
+	MappedFile() = default;
+	MappedFile(std::filesystem::path const& filename);
+	MappedFile(MappedFile const&) = delete;
+	MappedFile(MappedFile&&);
+	~MappedFile();
+	MappedFile& operator=(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile&&);
+
+private:
+	void unmap();
+
+public:
+	bool isOpen() const;
+	std::byte const* data() const;
+	std::size_t size() const;
+	void release(void const* range, std::size_t rangeSize) const;
+};
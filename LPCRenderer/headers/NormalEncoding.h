@@ -0,0 +1,49 @@
+#pragma once
+#include "Span.h"
+#include "Parallel.h"
+#include "glm/glm.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+//spherical coordinates, acos and atan when encoding and trig when decoding, precision clusters at the poles
+glm::vec2 toSpherical(glm::vec3 n);
+std::uint32_t toSpherical16(glm::vec3 n);
+std::uint16_t toSpherical8(glm::vec3 n);
+glm::vec3 fromSpherical(std::uint32_t packed, int bits);
+
+//the unit sphere projected onto an octahedron and unfolded into a square, bits per component,
+//spreads the precision evenly and decodes without trig
+inline std::uint32_t toOctahedral(glm::vec3 n, int bits)
+{
+	//branch free, so the loop below can be vectorized
+	float scale = float((1u << bits) - 1);
+	float inverseLength = 1.0f / std::max(std::abs(n.x) + std::abs(n.y) + std::abs(n.z), 1e-20f);
+	float x = n.x * inverseLength;
+	float y = n.y * inverseLength;
+	float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+	float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+	x = n.z < 0.0f ? foldedX : x;
+	y = n.z < 0.0f ? foldedY : y;
+	std::uint32_t u = static_cast<std::uint32_t>((x * 0.5f + 0.5f) * scale + 0.5f);
+	std::uint32_t v = static_cast<std::uint32_t>((y * 0.5f + 0.5f) * scale + 0.5f);
+	return u | v << bits;
+}
+
+glm::vec3 fromOctahedral(std::uint32_t packed, int bits);
+
+//T has to hold twice the bits per component
+template<typename T>
+std::vector<T> toOctahedral(Span<glm::vec3 const> normals, int bits)
+{
+	std::vector<T> packed(normals.size());
+	parallelFor(getWorkerCount(), normals.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+		glm::vec3 const* source = normals.data();
+		T* destination = packed.data();
+		for(std::size_t idx = begin; idx < end; idx++)
+			destination[idx] = static_cast<T>(toOctahedral(source[idx], bits));
+	});
+	return packed;
+}
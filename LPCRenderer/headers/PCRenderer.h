@@ -1,5 +1,6 @@
 #pragma once
 #include "GPUBuffer.h"
+#include "Span.h"
 
 enum class PCRenderType
 {
@@ -33,9 +34,14 @@ private:
 
 protected:
 	void bindVAO() const;
+	//one draw command per non empty brick in brick order, the way the brick renderers pack them
+	bool isBrickDrawCommandStream(Span<DrawCommand const> drawCommands) const;
+	//one element per point in brick order
+	bool isPointStream(std::size_t elementCount) const;
 
 public:
 	Shader* getMainShader() const;
+	void setPointCloud(PointCloud const* cloud);
 	virtual void update() = 0;
 	virtual void render(Scene const* scene);
 	virtual void drawUI();
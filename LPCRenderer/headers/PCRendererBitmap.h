@@ -1,9 +1,24 @@
 #pragma once
 #include "PCRenderer.h"
 #include "GPUBuffer.h"
+#include "Span.h"
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <vector>
 
 class PCRendererBitmap : public PCRenderer
 {
+public:
+	//gpu time to unpack every brick once, for both kernels
+	struct UnpackTiming
+	{
+		int bitmapSize = 0;
+		std::chrono::nanoseconds atomic{0};
+		std::chrono::nanoseconds scan{0};
+	};
+
 private:
 	GPUBuffer SSBOBitmaps{GL_SHADER_STORAGE_BUFFER};
 	GPUBuffer SSBOBitmapIndices{GL_SHADER_STORAGE_BUFFER};
@@ -12,6 +27,31 @@ private:
 	GPUBuffer Counter{GL_ATOMIC_COUNTER_BUFFER};
 	std::size_t totalBrickCount = 0;
 
+	//unpacked bricks stay on the gpu in fixed size slots, the least recently drawn one is evicted first
+	GPUBuffer SSBOCachePositions{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer SSBOCacheDrawCommands{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer SSBOCacheRequests{GL_SHADER_STORAGE_BUFFER};
+	std::vector<std::uint32_t> cacheSlotBitmaps;
+	std::vector<std::size_t> cacheSlotLastUse;
+	std::list<std::uint32_t> cacheLRU;
+	std::vector<std::list<std::uint32_t>::iterator> cacheLRUPositions;
+	std::vector<std::uint32_t> bitmapCacheSlots;
+	std::vector<std::uint32_t> visibleCacheSlots;
+	std::size_t cacheFrame = 0;
+	std::size_t cacheMissCount = 0;
+	std::size_t cacheOverBudgetCount = 0;
+
+	//all bricks are unpacked by one dispatch into a ring of segments and drawn with a gpu side count
+	GPUBuffer SSBOSegmentPositions{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer SSBOSegmentPositionOffsets{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer SSBOSegmentDrawCommands{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer SSBOSegmentDrawCounts{GL_SHADER_STORAGE_BUFFER};
+	//a copy, the packed stream it comes from may be evicted
+	std::vector<std::uint32_t> segmentPositionOffsets;
+	std::vector<std::size_t> segmentPasses;
+	std::size_t segmentCount = 0;
+	std::size_t segmentPositionCount = 0;
+
 public:
 	PCRendererBitmap();
 	PCRendererBitmap(const PCRendererBitmap&) = delete;
@@ -21,16 +61,25 @@ public:
 	PCRendererBitmap& operator=(PCRendererBitmap&&) = default;
 
 private:
+	Span<std::uint32_t const> getBitmapIndices() const;
 	void update32();
 	void update16();
 	void update8();
 	void update4();
+	void bindUnpackBuffers();
+	void unpackBatch(std::size_t firstBrick, std::size_t brickCount);
+	void updateSegments(Span<std::uint32_t const> positionOffsets);
+	void renderSegments(Scene const* scene);
+	void resetCache();
+	void updateCache(Scene const* scene);
 
 public:
 	virtual void update() override;
 	virtual void render(Scene const* scene) override;
 	virtual void drawUI() override;
 	virtual void reloadShaders() override;
+	//runs every bitmap size with both kernels, the current settings are restored afterwards
+	std::vector<UnpackTiming> benchmarkUnpacking(int repetitions);
 
 };
 
@@ -0,0 +1,29 @@
+#pragma once
+#include "PCRenderer.h"
+#include "GPUBuffer.h"
+
+//the per brick expansion of the geometry shader path done by a compute prepass instead, it writes one indirect
+//draw per brick and the vertex shader pulls the positions, so a brick may hold any number of points
+class PCRendererBrickExpansion : public PCRenderer
+{
+private:
+	GPUBuffer SSBOBricks{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer SSBOPositions{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer DrawBuffer{GL_DRAW_INDIRECT_BUFFER};
+	std::size_t brickCount = 0;
+
+public:
+	PCRendererBrickExpansion();
+	PCRendererBrickExpansion(const PCRendererBrickExpansion&) = delete;
+	PCRendererBrickExpansion(PCRendererBrickExpansion&&) = default;
+	~PCRendererBrickExpansion() = default;
+	PCRendererBrickExpansion& operator=(const PCRendererBrickExpansion&) = delete;
+	PCRendererBrickExpansion& operator=(PCRendererBrickExpansion&&) = default;
+
+public:
+	virtual void update() override;
+	virtual void render(Scene const* scene) override;
+	virtual void drawUI() override;
+	virtual void reloadShaders() override;
+
+};
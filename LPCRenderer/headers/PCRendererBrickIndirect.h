@@ -1,15 +1,51 @@
 #pragma once
 #include "PCRenderer.h"
 #include "GPUBuffer.h"
+#include "BrickResidency.h"
+#include "DepthPyramid.h"
+#include "PointCloud.h"
+
+#include <array>
+#include <initializer_list>
+#include <memory>
+#include <optional>
 
 class PCRendererBrickIndirect : public PCRenderer
 {
 private:
+	enum Stream
+	{
+		drawCommandStream,
+		positionStream,
+		normalStream,
+		colorStream,
+		streamCount
+	};
+
 	GPUBuffer VBOPositions{GL_ARRAY_BUFFER};
 	GPUBuffer VBONormals{GL_ARRAY_BUFFER};
 	GPUBuffer VBOColors{GL_ARRAY_BUFFER};
+	GPUBuffer SSBOAdaptiveBricks{GL_SHADER_STORAGE_BUFFER};
 	GPUBuffer DrawBuffer{GL_DRAW_INDIRECT_BUFFER};
+	//written by the culling passes, the first half is drawn before the depth pyramid is built, the second half after
+	GPUBuffer VisibleDrawBuffer{GL_DRAW_INDIRECT_BUFFER};
+	//draw counts of both passes followed by the frustum and occlusion culled brick counts
+	GPUBuffer VisibleDrawCount{GL_ATOMIC_COUNTER_BUFFER};
+	//the counters are copied here every frame and read a few frames later, so reading them never stalls
+	GPUBuffer CullingStatisticsReadback{GL_COPY_WRITE_BUFFER};
+	GPUBuffer SSBOBrickVisibility{GL_SHADER_STORAGE_BUFFER};
+	DepthPyramid depthPyramid;
+	std::array<unsigned int, 4> cullingStatistics{};
 	std::size_t indirectDrawCount = 0;
+	//of the compressed colours, measured whenever they are uploaded
+	float colorPSNR = 0.0f;
+	float adaptiveBitsPerPoint = 0.0f;
+	//whether the shaders read the streams by vertex id, vertex pulling may fall back to the attributes
+	bool pullingVertices = false;
+	//the key every stream was last uploaded from, a setting change only rebuilds the streams whose key changed
+	std::array<std::optional<PackedStreamKey>, streamCount> uploadedStreams;
+	PointCloud const* uploadedCloud = nullptr;
+	std::unique_ptr<BrickResidency> residency;
 
 public:
 	PCRendererBrickIndirect();
@@ -22,10 +58,21 @@ public:
 private:
 	bool needNormals() const;
 	bool needColors() const;
+	bool drawsColors() const;
+	bool needsUpload(Stream stream, PackedStreamKey const& key);
+	void updateDrawCommands();
 	void updatePositions32();
 	void updatePositions16();
+	void updatePositionsAdaptive();
 	void updateNormals16();
 	void updateNormals8();
+	void updateNormalsOctahedral();
+	void updateColors();
+	void updateOutOfCore();
+	void updateVertexPulling(std::initializer_list<GPUBuffer const*> streams);
+	void cullBricks(Scene const* scene, unsigned int cullPass);
+	void drawVisibleBricks(std::size_t pass) const;
+	void readCullingStatistics();
 
 public:
 	virtual void update() override;
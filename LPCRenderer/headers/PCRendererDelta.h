@@ -0,0 +1,42 @@
+#pragma once
+#include "PCRenderer.h"
+#include "GPUBuffer.h"
+#include "Span.h"
+
+#include <cstdint>
+#include <vector>
+
+//positions are morton sorted within every brick and stored as bit packed deltas, a compute shader decodes
+//them into a ring of segments right before they are drawn
+class PCRendererDelta : public PCRenderer
+{
+private:
+	GPUBuffer SSBODeltaStream{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer SSBOPositions{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer DrawBuffer{GL_DRAW_INDIRECT_BUFFER};
+	std::size_t brickCount = 0;
+	std::size_t pointCount = 0;
+	//every pass decodes the bricks between two entries into one segment
+	std::vector<std::size_t> passes;
+	std::vector<std::size_t> passFirstPoints;
+	std::size_t segmentCount = 0;
+	std::size_t segmentPositionCount = 0;
+
+public:
+	PCRendererDelta();
+	PCRendererDelta(const PCRendererDelta&) = delete;
+	PCRendererDelta(PCRendererDelta&&) = default;
+	~PCRendererDelta() = default;
+	PCRendererDelta& operator=(const PCRendererDelta&) = delete;
+	PCRendererDelta& operator=(PCRendererDelta&&) = default;
+
+private:
+	Span<std::uint32_t const> getDeltaStream() const;
+
+public:
+	virtual void update() override;
+	virtual void render(Scene const* scene) override;
+	virtual void drawUI() override;
+	virtual void reloadShaders() override;
+
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include "PCRenderer.h"
+#include "GPUBuffer.h"
+
+#include <cstdint>
+#include <vector>
+
+class PointCloudOctree;
+
+class PCRendererOctree : public PCRenderer
+{
+private:
+	GPUBuffer VBOPositions{GL_ARRAY_BUFFER};
+	GPUBuffer VBONormals{GL_ARRAY_BUFFER};
+	GPUBuffer VBOColors{GL_ARRAY_BUFFER};
+	GPUBuffer SSBONodes{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer DrawBuffer{GL_DRAW_INDIRECT_BUFFER};
+	std::size_t drawOffset = 0;
+	PointCloudOctree const* octree = nullptr;
+	std::vector<std::uint32_t> selection;
+	std::vector<DrawCommand> drawCommands;
+	std::size_t selectedPointCount = 0;
+
+public:
+	PCRendererOctree();
+	PCRendererOctree(const PCRendererOctree&) = delete;
+	PCRendererOctree(PCRendererOctree&&) = default;
+	~PCRendererOctree() = default;
+	PCRendererOctree& operator=(const PCRendererOctree&) = delete;
+	PCRendererOctree& operator=(PCRendererOctree&&) = default;
+
+private:
+	bool needNormals() const;
+	bool needColors() const;
+
+public:
+	virtual void update() override;
+	virtual void render(Scene const* scene) override;
+	virtual void drawUI() override;
+	virtual void reloadShaders() override;
+
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include "PCRenderer.h"
+#include "GPUBuffer.h"
+
+#include "glm/glm.hpp"
+
+//splats every point into a single pixel from a compute shader instead of the point pipeline, the nearest point
+//of each pixel wins an atomic max on its packed depth and colour, a fullscreen pass resolves the result
+class PCRendererRasterizer : public PCRenderer
+{
+private:
+	GPUBuffer SSBOPositions{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer SSBOColors{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer SSBODrawCommands{GL_SHADER_STORAGE_BUFFER};
+	GPUBuffer SSBOVisibility{GL_SHADER_STORAGE_BUFFER};
+	std::size_t drawCommandCount = 0;
+	glm::ivec2 resolution{0};
+
+public:
+	PCRendererRasterizer();
+	PCRendererRasterizer(const PCRendererRasterizer&) = delete;
+	PCRendererRasterizer(PCRendererRasterizer&&) = default;
+	~PCRendererRasterizer() = default;
+	PCRendererRasterizer& operator=(const PCRendererRasterizer&) = delete;
+	PCRendererRasterizer& operator=(PCRendererRasterizer&&) = default;
+
+private:
+	bool drawsColors() const;
+	std::size_t getVisibilityWords() const;
+
+public:
+	virtual void update() override;
+	virtual void render(Scene const* scene) override;
+	virtual void drawUI() override;
+	virtual void reloadShaders() override;
+
+};
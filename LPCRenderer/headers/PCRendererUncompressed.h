@@ -7,6 +7,7 @@ class PCRendererUncompressed : public PCRenderer
 private:
 	GPUBuffer VBO{GL_ARRAY_BUFFER};
 	std::size_t vertexCount = 0;
+	bool pullingVertices = false;
 	
 public:
 	PCRendererUncompressed();
@@ -0,0 +1,73 @@
+#pragma once
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+inline std::size_t getWorkerCount()
+{
+	return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+//shared by every parallelFor, the calling thread is the last worker
+ThreadPool& getWorkerPool();
+
+//splits [0, count) into one contiguous chunk per worker, chunk i always precedes chunk i + 1
+//so passes that depend on the original order can be stitched back together afterwards
+template<typename Function>
+void parallelFor(std::size_t workerCount, std::size_t count, Function&& function)
+{
+	workerCount = std::max<std::size_t>(1, std::min(workerCount, count));
+	std::size_t chunkSize = (count + workerCount - 1) / std::max<std::size_t>(1, workerCount);
+
+	//chunks are claimed rather than assigned, the caller takes whatever the pool has not started yet,
+	//so nested calls from pool tasks cannot wait on tasks queued behind themselves
+	struct State
+	{
+		std::atomic<std::size_t> nextChunk{0};
+		std::size_t finishedChunks = 0;
+		std::exception_ptr exception;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	auto state = std::make_shared<State>();
+	auto runChunks = [state, workerCount, chunkSize, count, &function]() {
+		for(std::size_t worker = state->nextChunk++; worker < workerCount; worker = state->nextChunk++)
+		{
+			std::size_t begin = std::min(count, worker * chunkSize);
+			std::size_t end = std::min(count, begin + chunkSize);
+			std::exception_ptr exception;
+			try
+			{
+				function(worker, begin, end);
+			}
+			catch(...)
+			{
+				exception = std::current_exception();
+			}
+			std::lock_guard lock{state->mutex};
+			if(exception && !state->exception)
+				state->exception = exception;
+			if(++state->finishedChunks == workerCount)
+				state->finished.notify_all();
+		}
+	};
+
+	//a task that starts after the last chunk was claimed returns right away, state outlives the call for it
+	for(std::size_t worker = 1; worker < workerCount; worker++)
+		getWorkerPool().submit(runChunks);
+	runChunks();
+	std::unique_lock lock{state->mutex};
+	state->finished.wait(lock, [&]() {
+		return state->finishedChunks == workerCount;
+	});
+	if(state->exception)
+		std::rethrow_exception(state->exception);
+}
@@ -1,15 +1,95 @@
 #pragma once
 #include "AutoName.h"
+#include "Span.h"
 #include "glm/glm.hpp"
-#include <vector>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 struct PointCloudBrick
 {
 	glm::ivec3 indices;
-	std::vector<glm::vec3> positions;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::u8vec3> colors;
+	Span<glm::vec3 const> positions;
+	Span<glm::vec3 const> normals;
+	Span<glm::u8vec3 const> colors;
+};
+
+class MappedFile;
+class PointCloudOctree;
+
+//identifies a renderer payload derived from the bricked points, parameters that do not apply stay 0
+struct PackedStreamKey
+{
+	std::string name;
+	glm::ivec3 subdivisions{0};
+	int positionBits = 0;
+	int normalBits = 0;
+	int bitmapSize = 0;
+	//bit pattern of a float tolerance, e.g. the adaptive positions' target error
+	std::uint32_t errorBits = 0;
+
+	bool operator<(PackedStreamKey const& other) const;
+	bool operator==(PackedStreamKey const& other) const;
+};
+
+struct PackedStream
+{
+	Span<std::byte const> data;
+	//keeps data alive, either the vector it was packed into or a mapped cache file
+	std::shared_ptr<void const> owner;
+	//for the least recently used eviction
+	std::size_t lastUse = 0;
+	//streams read from a cache file are checked against the cloud before their first use
+	bool verified = false;
+};
+
+//bricked point data borrowed from memory that outlives the cloud through owner, e.g. a mapped cache file
+struct PointCloudStorage
+{
+	std::shared_ptr<void const> owner;
+	//set when the borrowed memory is a file mapping, lets bricks be dropped from memory after use
+	MappedFile const* mapping = nullptr;
+	std::pair<glm::vec3, glm::vec3> bounds;
+	glm::ivec3 subdivisions{0};
+	Span<glm::vec3 const> positions;
+	Span<glm::vec3 const> normals;
+	Span<glm::u8vec3 const> colors;
+	Span<std::size_t const> brickOffsets;
+	std::map<PackedStreamKey, PackedStream> packedStreams;
+};
+
+class PointCloud;
+
+class PointCloudBricks
+{
+public:
+	class Iterator
+	{
+	private:
+		PointCloudBricks const* bricks;
+		std::size_t idx;
+
+	public:
+		Iterator(PointCloudBricks const* bricks, std::size_t idx);
+		PointCloudBrick operator*() const;
+		Iterator& operator++();
+		bool operator==(Iterator const& other) const;
+		bool operator!=(Iterator const& other) const;
+	};
+
+private:
+	PointCloud const* cloud;
+
+public:
+	PointCloudBricks(PointCloud const* cloud);
+
+public:
+	std::size_t size() const;
+	PointCloudBrick operator[](std::size_t idx) const;
+	Iterator begin() const;
+	Iterator end() const;
 };
 
 
@@ -21,25 +101,54 @@ private:
 	bool _hasColors = false;
 	glm::ivec3 subdivisions{0};
 	glm::vec3 brickSize;
-	std::vector<PointCloudBrick> bricks;
+	//all points sorted by brick, positions are relative to their brick
+	//the views either point into the owned vectors or into memory kept alive by storageOwner
+	Span<glm::vec3 const> positions;
+	Span<glm::vec3 const> normals;
+	Span<glm::u8vec3 const> colors;
+	//brick i holds the points [brickOffsets[i], brickOffsets[i + 1])
+	Span<std::size_t const> brickOffsets;
+	std::vector<glm::vec3> ownedPositions;
+	std::vector<glm::vec3> ownedNormals;
+	std::vector<glm::u8vec3> ownedColors;
+	std::vector<std::size_t> ownedBrickOffsets;
+	std::shared_ptr<void const> storageOwner;
+	MappedFile const* storageMapping = nullptr;
+	mutable std::map<PackedStreamKey, PackedStream> packedStreams;
+	//evicted streams stay alive until releaseRetiredPackedStreams, callers may still hold views of them
+	mutable std::vector<std::shared_ptr<void const>> retiredPackedStreams;
+	mutable std::size_t packedStreamUses = 0;
+	//built on first use, it only depends on the points and survives changing the subdivisions
+	mutable std::shared_ptr<PointCloudOctree const> octree;
 	std::size_t vertexCount = 0;
 	mutable std::size_t emptyBrickCount = 0;
 	mutable std::size_t redundantPointsIfCompressed = 0;
 	mutable float pointsPerBrickAverage = 0;
 	mutable std::size_t brickPrecision = 32;
+	//the precision redundantPointsIfCompressed was counted at, 0 before the first count
+	mutable std::size_t statisticsPrecision = 0;
 
 public:
 	PointCloud(std::vector<glm::vec3>&& positions, std::vector<glm::vec3>&& normals = {}, std::vector<glm::u8vec3>&& colors = {});
+	PointCloud(PointCloudStorage storage);
 	PointCloud() = delete;
-	PointCloud(PointCloud const& other) = default;
+	PointCloud(PointCloud const& other) = delete;
 	PointCloud(PointCloud&& other) = default;
 	~PointCloud() = default;
-	PointCloud& operator=(PointCloud const& other) = default;
-	PointCloud& operator=(PointCloud&& other) = default;
+	PointCloud& operator=(PointCloud const& other) = delete;
+	PointCloud& operator=(PointCloud&& other) = delete;
 
 protected:
 	std::string getNamePrefix() const;
 
+private:
+	std::size_t getBrickIndex(glm::ivec3 indices) const;
+	static glm::ivec3 getBrickIndices(std::size_t idx, glm::ivec3 subdivisions);
+	void viewOwnedStorage();
+	void updateBrickStatistics() const;
+	void evictPackedStreams(PackedStreamKey const& keep) const;
+	void rejectPackedStream(PackedStreamKey const& key) const;
+
 public:
 	void setBrickPrecision(std::size_t precision) const;
 	void updateStatistics() const;
@@ -50,8 +159,23 @@ public:
 	glm::vec3 getSize() const;
 	glm::ivec3 getSubdivisions() const;
 	glm::vec3 getBrickSize() const;
-	std::vector<PointCloudBrick> const& getAllBricks() const;
-	PointCloudBrick& getBrickAt(glm::ivec3 indices);
+	std::size_t getBrickCount() const;
+	PointCloudBricks getAllBricks() const;
+	PointCloudBrick getBrickAt(std::size_t idx) const;
+	PointCloudBrick getBrickAt(glm::ivec3 indices) const;
+	Span<glm::vec3 const> getPositions() const;
+	Span<glm::vec3 const> getNormals() const;
+	Span<glm::u8vec3 const> getColors() const;
+	Span<std::size_t const> getBrickOffsets() const;
+	std::shared_ptr<void const> const& getStorageOwner() const;
+	MappedFile const* getStorageMapping() const;
+	std::map<PackedStreamKey, PackedStream> const& getPackedStreams() const;
+	template<typename T, typename Pack, typename IsValid>
+	Span<T const> getPackedStream(PackedStreamKey const& key, Pack&& pack, IsValid&& isValid) const;
+	void clearPackedStreams() const;
+	//once per frame, when no views of evicted streams are left
+	void releaseRetiredPackedStreams() const;
+	PointCloudOctree const& getOctree() const;
 	glm::vec3 convertToWorldPosition(glm::ivec3 indices, glm::vec3 localPosition) const;
 	std::pair<glm::vec3, glm::vec3> getBoundsAt(glm::ivec3 indices) const;
 	glm::vec3 getOffsetAt(glm::ivec3 indices) const;
@@ -61,8 +185,42 @@ public:
 
 };
 
+//returns the stream stored under key, packing and keeping it on first use so mode switches only cost an upload,
+//the view stays valid until the end of the frame, isValid checks a stream read from a cache file before it is trusted,
+//the renderers hand its contents to the gpu as they are
+template<typename T, typename Pack, typename IsValid>
+Span<T const> PointCloud::getPackedStream(PackedStreamKey const& key, Pack&& pack, IsValid&& isValid) const
+{
+	auto stream = packedStreams.find(key);
+	if(stream != packedStreams.end() && !stream->second.verified)
+	{
+		Span<std::byte const> data = stream->second.data;
+		stream->second.verified = data.size() % sizeof(T) == 0 && reinterpret_cast<std::uintptr_t>(data.data()) % alignof(T) == 0
+			&& isValid(Span<T const>{reinterpret_cast<T const*>(data.data()), data.size() / sizeof(T)});
+		if(!stream->second.verified)
+		{
+			rejectPackedStream(key);
+			stream = packedStreams.end();
+		}
+	}
+	bool packed = stream == packedStreams.end();
+	if(packed)
+	{
+		auto packedData = std::make_shared<std::vector<T> const>(pack());
+		Span<std::byte const> data{reinterpret_cast<std::byte const*>(packedData->data()), packedData->size() * sizeof(T)};
+		stream = packedStreams.emplace(key, PackedStream{data, std::move(packedData), 0, true}).first;
+	}
+	stream->second.lastUse = ++packedStreamUses;
+	if(packed)
+		evictPackedStreams(key);
+	Span<std::byte const> data = stream->second.data;
+	return {reinterpret_cast<T const*>(data.data()), data.size() / sizeof(T)};
+}
+
 std::uint32_t packPosition1024(glm::vec3);
 std::uint16_t packPosition32(glm::vec3);
 std::uint16_t packPosition16(glm::vec3);
 std::uint16_t packPosition8(glm::vec3);
-std::uint16_t packPosition4(glm::vec3);
\ No newline at end of file
+std::uint16_t packPosition4(glm::vec3);
+//interleaves the bits of up to 10 bit cell coordinates, x in the lowest bit
+std::uint32_t encodeMorton(glm::uvec3 cell);
\ No newline at end of file
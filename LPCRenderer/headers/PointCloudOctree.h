@@ -0,0 +1,68 @@
+#pragma once
+#include "Span.h"
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class PointCloud;
+
+struct PointCloudOctreeNode
+{
+	//nodes are cubes, so the sampling grid spacing is the same along every axis
+	glm::vec3 origin{0.0f};
+	float size = 0.0f;
+	float spacing = 0.0f;
+	std::uint32_t depth = 0;
+	//children are stored back to back, childMask tells which octants they occupy
+	std::uint32_t firstChild = 0;
+	std::uint8_t childCount = 0;
+	std::uint8_t childMask = 0;
+	//the points held by this node itself, excluding those of its children
+	std::size_t offset = 0;
+	std::size_t count = 0;
+
+	std::pair<glm::vec3, glm::vec3> getBounds() const;
+};
+
+//multi resolution octree in the spirit of Potree, every node keeps a grid subsample of the points below it
+//and passes the remaining points on to its children, drawing a node adds detail to the nodes above it
+class PointCloudOctree
+{
+public:
+	static constexpr int samplingGridSize = 128;
+	static constexpr std::size_t maxLeafPointCount = 20'000;
+	static constexpr std::uint32_t maxDepth = 20;
+	//octahedral normals, two components per 16 bits
+	static constexpr int normalComponentBits = 8;
+
+private:
+	//breadth first, so node 0 is the root and every level follows the previous one
+	std::vector<PointCloudOctreeNode> nodes;
+	//all points sorted by node, positions are relative to their node like they are relative to a brick,
+	//stored in the compressed form the renderer uploads so neither RAM nor VRAM hold full floats
+	std::vector<std::uint32_t> positions;
+	std::vector<std::uint16_t> normals;
+	std::vector<glm::u8vec3> colors;
+	std::uint32_t depth = 0;
+
+public:
+	PointCloudOctree(PointCloud const& cloud);
+
+private:
+	void sortPoints(PointCloud const& cloud, std::vector<glm::vec3> const& worldPositions, std::vector<std::uint32_t> const& order);
+
+public:
+	//collects the nodes whose parent's spacing projects to more than maxScreenError pixels, largest error first,
+	//until pointBudget is reached, projectionScale converts a model space size at distance 1 into pixels
+	std::size_t selectNodes(glm::mat4 const& modelViewProjection, glm::vec3 cameraPosition, float projectionScale,
+		float maxScreenError, std::size_t pointBudget, std::vector<std::uint32_t>& selection) const;
+	Span<PointCloudOctreeNode const> getNodes() const;
+	Span<std::uint32_t const> getPositions() const;
+	Span<std::uint16_t const> getNormals() const;
+	Span<glm::u8vec3 const> getColors() const;
+	std::uint32_t getDepth() const;
+	std::size_t getMemoryConsumption() const;
+};
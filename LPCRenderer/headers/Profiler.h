@@ -8,5 +8,11 @@ namespace Profiler
 	void endFenceWait();
 	void recordGPUAllocation(std::size_t size);
 	void recordGPUDeallocation(std::size_t size);
+	std::size_t getGPUAllocatedBytes();
+	std::size_t getResidentBytes();
+	void recordBrickPageIn(std::size_t size);
+	void recordBrickUpload(std::size_t size);
+	void recordBrickEviction(bool fromGPU);
+	void recordBrickResidency(std::size_t hostBytes, std::size_t hostBudget, std::size_t gpuBytes, std::size_t gpuBudget);
 	void drawUI();
 }
\ No newline at end of file
@@ -30,6 +30,7 @@ public:
 	void set(std::string_view const name, std::size_t value) const;
 	void set(std::string_view const name, float value) const;
 	void set(std::string_view const name, glm::uvec3 const& value) const;
+	void set(std::string_view const name, glm::ivec2 const& value) const;
 	void set(std::string_view const name, glm::vec2 const& value) const;
 	void set(std::string_view const name, glm::vec3 const& value) const;
 	void set(std::string_view const name, glm::vec4 const& value) const;
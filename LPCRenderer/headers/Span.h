@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+
+//non-owning view over a contiguous range of elements
+template<typename T>
+class Span
+{
+private:
+	T* first = nullptr;
+	std::size_t count = 0;
+
+public:
+	Span() = default;
+	Span(T* first, std::size_t count)
+		:first(first), count(count)
+	{
+	}
+
+public:
+	T* data() const
+	{
+		return first;
+	}
+
+	std::size_t size() const
+	{
+		return count;
+	}
+
+	std::size_t sizeInBytes() const
+	{
+		return count * sizeof(T);
+	}
+
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	T* begin() const
+	{
+		return first;
+	}
+
+	T* end() const
+	{
+		return first + count;
+	}
+
+	T& operator[](std::size_t idx) const
+	{
+		return first[idx];
+	}
+
+	Span subspan(std::size_t offset, std::size_t length) const
+	{
+		return {first + offset, length};
+	}
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::packaged_task<void()>> tasks;
+	std::mutex tasksMutex;
+	std::condition_variable tasksAvailable;
+	bool stopping = false;
+
+public:
+	ThreadPool(std::size_t workerCount);
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool(ThreadPool&&) = delete;
+	~ThreadPool();
+	ThreadPool& operator=(ThreadPool const&) = delete;
+	ThreadPool& operator=(ThreadPool&&) = delete;
+
+private:
+	void work();
+
+public:
+	std::size_t getWorkerCount() const;
+	std::future<void> submit(std::function<void()> task);
+};
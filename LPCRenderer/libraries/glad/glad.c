@@ -7,16 +7,17 @@
     APIs: gl=4.5
     Profile: core
     Extensions:
-        GL_ARB_compute_variable_group_size
+        GL_ARB_compute_variable_group_size,
+        GL_ARB_indirect_parameters
     Loader: True
     Local files: False
     Omit khrplatform: False
     Reproducible: False
 
     Commandline:
-        --profile="core" --api="gl=4.5" --generator="c" --spec="gl" --extensions="GL_ARB_compute_variable_group_size"
+        --profile="core" --api="gl=4.5" --generator="c" --spec="gl" --extensions="GL_ARB_compute_variable_group_size,GL_ARB_indirect_parameters"
     Online:
-        https://glad.dav1d.de/#profile=core&language=c&specification=gl&loader=on&api=gl%3D4.5&extensions=GL_ARB_compute_variable_group_size
+        https://glad.dav1d.de/#profile=core&language=c&specification=gl&loader=on&api=gl%3D4.5&extensions=GL_ARB_compute_variable_group_size&extensions=GL_ARB_indirect_parameters
 */
 
 #include <stdio.h>
@@ -967,6 +968,9 @@ PFNGLVIEWPORTINDEXEDFVPROC glad_glViewportIndexedfv = NULL;
 PFNGLWAITSYNCPROC glad_glWaitSync = NULL;
 int GLAD_GL_ARB_compute_variable_group_size = 0;
 PFNGLDISPATCHCOMPUTEGROUPSIZEARBPROC glad_glDispatchComputeGroupSizeARB = NULL;
+int GLAD_GL_ARB_indirect_parameters = 0;
+PFNGLMULTIDRAWARRAYSINDIRECTCOUNTARBPROC glad_glMultiDrawArraysIndirectCountARB = NULL;
+PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTARBPROC glad_glMultiDrawElementsIndirectCountARB = NULL;
 static void load_GL_VERSION_1_0(GLADloadproc load) {
 	if(!GLAD_GL_VERSION_1_0) return;
 	glad_glCullFace = (PFNGLCULLFACEPROC)load("glCullFace");
@@ -1724,9 +1728,15 @@ static void load_GL_ARB_compute_variable_group_size(GLADloadproc load) {
 	if(!GLAD_GL_ARB_compute_variable_group_size) return;
 	glad_glDispatchComputeGroupSizeARB = (PFNGLDISPATCHCOMPUTEGROUPSIZEARBPROC)load("glDispatchComputeGroupSizeARB");
 }
+static void load_GL_ARB_indirect_parameters(GLADloadproc load) {
+	if(!GLAD_GL_ARB_indirect_parameters) return;
+	glad_glMultiDrawArraysIndirectCountARB = (PFNGLMULTIDRAWARRAYSINDIRECTCOUNTARBPROC)load("glMultiDrawArraysIndirectCountARB");
+	glad_glMultiDrawElementsIndirectCountARB = (PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTARBPROC)load("glMultiDrawElementsIndirectCountARB");
+}
 static int find_extensionsGL(void) {
 	if (!get_exts()) return 0;
 	GLAD_GL_ARB_compute_variable_group_size = has_ext("GL_ARB_compute_variable_group_size");
+	GLAD_GL_ARB_indirect_parameters = has_ext("GL_ARB_indirect_parameters");
 	free_exts();
 	return 1;
 }
@@ -1818,6 +1828,7 @@ int gladLoadGLLoader(GLADloadproc load) {
 
 	if (!find_extensionsGL()) return 0;
 	load_GL_ARB_compute_variable_group_size(load);
+	load_GL_ARB_indirect_parameters(load);
 	return GLVersion.major != 0 || GLVersion.minor != 0;
 }
 
@@ -1,12 +1,29 @@
 #version 460 core
 
-layout(location = 0) in vec3 position;
+layout(location = 0) in vec3 attributePosition;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+uniform int vertexPulling;
+uniform uint positionOffset;
+uniform uint vertexStride;
+
+//with vertex pulling the positions are read from one float stream, at any offsets and stride
+layout(std430, binding = 0) restrict readonly buffer VertexStream
+{
+	float vertexData[];
+};
+
+vec3 pullVertex(uint offset)
+{
+	uint first = offset + uint(gl_VertexID) * vertexStride;
+	return vec3(vertexData[first], vertexData[first + 1], vertexData[first + 2]);
+}
+
 void main()
 {
+	vec3 position = vertexPulling != 0 ? pullVertex(positionOffset) : attributePosition;
 	gl_Position = projection * view * model * vec4(position, 1);	
 }
\ No newline at end of file
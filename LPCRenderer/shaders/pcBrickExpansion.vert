@@ -0,0 +1,30 @@
+#version 460 core
+
+uniform vec3 cloudOrigin;
+uniform vec3 brickSize;
+uniform uvec3 subdivisions;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+//the same positions as the geometry shader path, pulled by vertex id
+layout(std430, binding = 2) restrict readonly buffer Positions
+{
+	uint positions[];
+};
+
+void main()
+{
+	vec3 relativePosition = unpackUnorm4x8(positions[gl_VertexID]).xyz * brickSize;
+
+	uint index = gl_BaseInstance;
+	uvec3 indices;
+	indices.z = index / ((subdivisions.x + 1) * (subdivisions.y + 1));//count surfaces
+	index  = index % ((subdivisions.x + 1) * (subdivisions.y + 1));
+	indices.y = index / (subdivisions.x + 1);//count lines
+	indices.x = index % (subdivisions.x + 1);//count points
+
+	vec3 brickOrigin = indices * brickSize;
+
+	gl_Position = projection * view * model * vec4(cloudOrigin + brickOrigin + relativePosition, 1);
+}
@@ -7,23 +7,87 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 uniform int positionSize;
+uniform int adaptivePrecision;
+uniform int vertexPulling;
+
+//the quantization grid of every brick, indexed by brick
+struct AdaptiveBrick
+{
+	vec3 minimum;
+	uint firstPoint;
+	vec3 extent;
+	uint bits;
+	uint dataOffset;
+};
+
+layout(std430, binding = 4) restrict readonly buffer AdaptiveBricks
+{
+	AdaptiveBrick adaptiveBricks[];
+};
+
+//the bit packed cells of the adaptive positions, with vertex pulling the fixed size positions otherwise
+layout(std430, binding = 5) restrict readonly buffer PositionStream
+{
+	uint positionWords[];
+};
 
 layout(location = 0) in uint compressedPosition;
 
+//with vertex pulling the packed streams are indexed by vertex id instead of being fetched as attributes
+uint pullPosition()
+{
+	if(vertexPulling == 0)
+		return compressedPosition;
+	uint vertex = uint(gl_VertexID);
+	if(positionSize == 16)
+		return bitfieldExtract(positionWords[vertex / 2], int(16 * (vertex % 2)), 16);
+	return positionWords[vertex];
+}
+
+//fields are at most 16 bits wide, so they never span more than two words
+uint readAdaptiveBits(uint firstWord, uint bit, uint width)
+{
+	if(width == 0)
+		return 0;
+	uint word = firstWord + bit / 32;
+	uint shift = bit % 32;
+	uint value = positionWords[word] >> shift;
+	if(shift + width > 32)
+		value |= positionWords[word + 1] << (32 - shift);
+	return value & ((1u << width) - 1);
+}
+
+//the centre of the point's cell, every draw starts at its brick's first point
+vec3 decodeAdaptivePosition()
+{
+	AdaptiveBrick brick = adaptiveBricks[gl_BaseInstance];
+	uvec3 bits = uvec3(brick.bits, brick.bits >> 5, brick.bits >> 10) & 31u;
+	uint bit = (uint(gl_VertexID) - brick.firstPoint) * (bits.x + bits.y + bits.z);
+	uvec3 cell;
+	cell.x = readAdaptiveBits(brick.dataOffset, bit, bits.x);
+	cell.y = readAdaptiveBits(brick.dataOffset, bit + bits.x, bits.y);
+	cell.z = readAdaptiveBits(brick.dataOffset, bit + bits.x + bits.y, bits.z);
+	return brick.minimum + (vec3(cell) + 0.5f) / vec3(uvec3(1u) << bits) * brick.extent;
+}
+
 void main()
 {
 	vec3 relativePosition;
-	if(positionSize == 16)
+	if(adaptivePrecision != 0)
+		relativePosition = decodeAdaptivePosition();
+	else if(positionSize == 16)
 	{
-		relativePosition.x = float(bitfieldExtract(compressedPosition, 0, 5)) / 32.0f;
-		relativePosition.y = float(bitfieldExtract(compressedPosition, 5, 5)) / 32.0f;
-		relativePosition.z = float(bitfieldExtract(compressedPosition, 10, 5)) / 32.0f;
+		uint packedPosition = pullPosition();
+		relativePosition.x = float(bitfieldExtract(packedPosition, 0, 5)) / 32.0f;
+		relativePosition.y = float(bitfieldExtract(packedPosition, 5, 5)) / 32.0f;
+		relativePosition.z = float(bitfieldExtract(packedPosition, 10, 5)) / 32.0f;
 	}
 	else if (positionSize == 32)
 	{
-		relativePosition.x = float(bitfieldExtract(compressedPosition, 0, 10)) / 1024.0f;
-		relativePosition.y = float(bitfieldExtract(compressedPosition, 10, 10)) / 1024.0f;
-		relativePosition.z = float(bitfieldExtract(compressedPosition, 20, 10)) / 1024.0f;
+		uint packedPosition = pullPosition();
+		relativePosition.x = float(bitfieldExtract(packedPosition, 0, 10)) / 1024.0f;
+		relativePosition.y = float(bitfieldExtract(packedPosition, 10, 10)) / 1024.0f;
+		relativePosition.z = float(bitfieldExtract(packedPosition, 20, 10)) / 1024.0f;
 	}
 	relativePosition *= brickSize;
 	
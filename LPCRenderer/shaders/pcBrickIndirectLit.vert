@@ -8,7 +8,38 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 uniform int positionSize;
-uniform int normalSize;
+uniform int adaptivePrecision;
+uniform int vertexPulling;
+uniform int normalStride;//bits per normal in the stream
+
+//the quantization grid of every brick, indexed by brick
+struct AdaptiveBrick
+{
+	vec3 minimum;
+	uint firstPoint;
+	vec3 extent;
+	uint bits;
+	uint dataOffset;
+};
+
+layout(std430, binding = 4) restrict readonly buffer AdaptiveBricks
+{
+	AdaptiveBrick adaptiveBricks[];
+};
+
+//the bit packed cells of the adaptive positions, with vertex pulling the fixed size positions otherwise
+layout(std430, binding = 5) restrict readonly buffer PositionStream
+{
+	uint positionWords[];
+};
+
+layout(std430, binding = 6) restrict readonly buffer NormalStream
+{
+	uint normalWords[];
+};
+
+uniform int normalEncoding;//0 spherical, 1 octahedral
+uniform int normalSize;//bits per component
 
 layout(location = 0) in uint compressedPosition;
 layout(location = 1) in uint compressedNormal;
@@ -21,6 +52,9 @@ out VS_OUT
 } vs_out;
 
 vec3 decodePosition();
+vec3 decodeAdaptivePosition();
+uint pullPosition();
+uint pullNormal();
 vec3 decodeNormal();
 
 void main()
@@ -35,17 +69,21 @@ void main()
 vec3 decodePosition()
 {
 	vec3 relativePosition;
-	if(positionSize == 16)
+	if(adaptivePrecision != 0)
+		relativePosition = decodeAdaptivePosition();
+	else if(positionSize == 16)
 	{
-		relativePosition.x = float(bitfieldExtract(compressedPosition, 0, 5)) / 32.0f;
-		relativePosition.y = float(bitfieldExtract(compressedPosition, 5, 5)) / 32.0f;
-		relativePosition.z = float(bitfieldExtract(compressedPosition, 10, 5)) / 32.0f;
+		uint packedPosition = pullPosition();
+		relativePosition.x = float(bitfieldExtract(packedPosition, 0, 5)) / 32.0f;
+		relativePosition.y = float(bitfieldExtract(packedPosition, 5, 5)) / 32.0f;
+		relativePosition.z = float(bitfieldExtract(packedPosition, 10, 5)) / 32.0f;
 	}
 	else if (positionSize == 32)
 	{
-		relativePosition.x = float(bitfieldExtract(compressedPosition, 0, 10)) / 1024.0f;
-		relativePosition.y = float(bitfieldExtract(compressedPosition, 10, 10)) / 1024.0f;
-		relativePosition.z = float(bitfieldExtract(compressedPosition, 20, 10)) / 1024.0f;
+		uint packedPosition = pullPosition();
+		relativePosition.x = float(bitfieldExtract(packedPosition, 0, 10)) / 1024.0f;
+		relativePosition.y = float(bitfieldExtract(packedPosition, 10, 10)) / 1024.0f;
+		relativePosition.z = float(bitfieldExtract(packedPosition, 20, 10)) / 1024.0f;
 	}
 	relativePosition *= brickSize;
 
@@ -61,13 +99,70 @@ vec3 decodePosition()
 
 vec3 decodeNormal()
 {
+	uint packedNormal = pullNormal();
+	if(normalEncoding == 1)
+	{
+		vec2 f = vec2(bitfieldExtract(packedNormal, 0, normalSize), bitfieldExtract(packedNormal, normalSize, normalSize));
+		f = f / float((1 << normalSize) - 1) * 2.0f - 1.0f;
+		vec3 n = vec3(f, 1.0f - abs(f.x) - abs(f.y));
+		float t = max(-n.z, 0.0f);
+		n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0f)));
+		return normalize(n);
+	}
+
 	vec2 s;
-	s.x = float(bitfieldExtract(compressedNormal, 0, normalSize)) / (1 << normalSize);
-	s.y = float(bitfieldExtract(compressedNormal, normalSize, normalSize)) / (1 << normalSize);
+	s.x = float(bitfieldExtract(packedNormal, 0, normalSize)) / (1 << normalSize);
+	s.y = float(bitfieldExtract(packedNormal, normalSize, normalSize)) / (1 << normalSize);
 
 	float theta = s.y * pi;
     float phi   = (s.x * (2.0 * pi) - pi);
 
     float sintheta = sin(theta);
     return vec3(sintheta * sin(phi), cos(theta), sintheta * cos(phi));
-}
\ No newline at end of file
+}
+
+//with vertex pulling the packed streams are indexed by vertex id instead of being fetched as attributes
+uint pullPosition()
+{
+	if(vertexPulling == 0)
+		return compressedPosition;
+	uint vertex = uint(gl_VertexID);
+	if(positionSize == 16)
+		return bitfieldExtract(positionWords[vertex / 2], int(16 * (vertex % 2)), 16);
+	return positionWords[vertex];
+}
+
+uint pullNormal()
+{
+	if(vertexPulling == 0)
+		return compressedNormal;
+	uint vertex = uint(gl_VertexID);
+	uint normalsPerWord = 32 / normalStride;
+	return bitfieldExtract(normalWords[vertex / normalsPerWord], int(normalStride * (vertex % normalsPerWord)), normalStride);
+}
+
+//fields are at most 16 bits wide, so they never span more than two words
+uint readAdaptiveBits(uint firstWord, uint bit, uint width)
+{
+	if(width == 0)
+		return 0;
+	uint word = firstWord + bit / 32;
+	uint shift = bit % 32;
+	uint value = positionWords[word] >> shift;
+	if(shift + width > 32)
+		value |= positionWords[word + 1] << (32 - shift);
+	return value & ((1u << width) - 1);
+}
+
+//the centre of the point's cell, every draw starts at its brick's first point
+vec3 decodeAdaptivePosition()
+{
+	AdaptiveBrick brick = adaptiveBricks[gl_BaseInstance];
+	uvec3 bits = uvec3(brick.bits, brick.bits >> 5, brick.bits >> 10) & 31u;
+	uint bit = (uint(gl_VertexID) - brick.firstPoint) * (bits.x + bits.y + bits.z);
+	uvec3 cell;
+	cell.x = readAdaptiveBits(brick.dataOffset, bit, bits.x);
+	cell.y = readAdaptiveBits(brick.dataOffset, bit + bits.x, bits.y);
+	cell.z = readAdaptiveBits(brick.dataOffset, bit + bits.x + bits.y, bits.z);
+	return brick.minimum + (vec3(cell) + 0.5f) / vec3(uvec3(1u) << bits) * brick.extent;
+}
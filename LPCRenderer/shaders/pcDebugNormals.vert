@@ -1,15 +1,34 @@
 #version 460 core
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 normal;
+layout(location = 0) in vec3 attributePosition;
+layout(location = 1) in vec3 attributeNormal;
 
 out VS_OUT
 {
 	vec3 normal;
 } vs_out;
 
+uniform int vertexPulling;
+uniform uint positionOffset;
+uniform uint normalOffset;
+uniform uint vertexStride;
+
+//with vertex pulling the positions and normals are read from one float stream, at any offsets and stride
+layout(std430, binding = 0) restrict readonly buffer VertexStream
+{
+	float vertexData[];
+};
+
+vec3 pullVertex(uint offset)
+{
+	uint first = offset + uint(gl_VertexID) * vertexStride;
+	return vec3(vertexData[first], vertexData[first + 1], vertexData[first + 2]);
+}
+
 void main()
 {
+	vec3 position = vertexPulling != 0 ? pullVertex(positionOffset) : attributePosition;
+	vec3 normal = vertexPulling != 0 ? pullVertex(normalOffset) : attributeNormal;
 	vs_out.normal = normal;
 	gl_Position = vec4(position, 1.0f);	
 }
\ No newline at end of file
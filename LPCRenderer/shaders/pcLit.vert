@@ -1,7 +1,7 @@
 #version 460 core
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 normal;
+layout(location = 0) in vec3 attributePosition;
+layout(location = 1) in vec3 attributeNormal;
 
 uniform mat4 model;
 uniform mat4 view;
@@ -20,8 +20,27 @@ out VS_OUT
 	vec3 normal;
 } vs_out;
 
+uniform int vertexPulling;
+uniform uint positionOffset;
+uniform uint normalOffset;
+uniform uint vertexStride;
+
+//with vertex pulling the positions and normals are read from one float stream, at any offsets and stride
+layout(std430, binding = 0) restrict readonly buffer VertexStream
+{
+	float vertexData[];
+};
+
+vec3 pullVertex(uint offset)
+{
+	uint first = offset + uint(gl_VertexID) * vertexStride;
+	return vec3(vertexData[first], vertexData[first + 1], vertexData[first + 2]);
+}
+
 void main()
 {
+	vec3 position = vertexPulling != 0 ? pullVertex(positionOffset) : attributePosition;
+	vec3 normal = vertexPulling != 0 ? pullVertex(normalOffset) : attributeNormal;
 	vs_out.position = vec3(view * model * vec4(position, 1.0f));
 	vs_out.normal = mat3(transpose(inverse(view * model))) * normal;
 	if(backFaceCulling && dot(vs_out.normal, -vs_out.position) < 0)
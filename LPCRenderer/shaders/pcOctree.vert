@@ -0,0 +1,24 @@
+#version 460 core
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+layout(location = 0) in uint compressedPosition;
+
+//origin and size of every octree node, indexed by the base instance of its draw command
+layout(std430, binding = 0) readonly buffer Nodes
+{
+	vec4 nodes[];
+};
+
+void main()
+{
+	vec3 relativePosition;
+	relativePosition.x = float(bitfieldExtract(compressedPosition, 0, 10)) / 1024.0f;
+	relativePosition.y = float(bitfieldExtract(compressedPosition, 10, 10)) / 1024.0f;
+	relativePosition.z = float(bitfieldExtract(compressedPosition, 20, 10)) / 1024.0f;
+
+	vec4 node = nodes[gl_BaseInstance];
+	gl_Position = projection * view * model * vec4(node.xyz + relativePosition * node.w, 1);
+}
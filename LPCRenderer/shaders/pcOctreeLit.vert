@@ -0,0 +1,53 @@
+#version 460 core
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+layout(location = 0) in uint compressedPosition;
+layout(location = 1) in uint compressedNormal;
+
+layout(std430, binding = 0) readonly buffer Nodes
+{
+	vec4 nodes[];
+};
+
+out VS_OUT
+{
+	vec3 viewSpacePosition;
+	vec3 viewSpaceNormal;
+	vec3 modelSpaceNormal;
+} vs_out;
+
+vec3 decodePosition();
+vec3 decodeNormal();
+
+void main()
+{
+	gl_Position = vec4(decodePosition(), 1.0f);
+
+	vs_out.viewSpacePosition = vec3(view * model * gl_Position);
+	vs_out.modelSpaceNormal = decodeNormal();
+	vs_out.viewSpaceNormal = mat3(transpose(inverse(view * model))) * vs_out.modelSpaceNormal;
+}
+
+vec3 decodePosition()
+{
+	vec3 relativePosition;
+	relativePosition.x = float(bitfieldExtract(compressedPosition, 0, 10)) / 1024.0f;
+	relativePosition.y = float(bitfieldExtract(compressedPosition, 10, 10)) / 1024.0f;
+	relativePosition.z = float(bitfieldExtract(compressedPosition, 20, 10)) / 1024.0f;
+
+	vec4 node = nodes[gl_BaseInstance];
+	return node.xyz + relativePosition * node.w;
+}
+
+//octahedral, 8 bits per component
+vec3 decodeNormal()
+{
+	vec2 f = vec2(bitfieldExtract(compressedNormal, 0, 8), bitfieldExtract(compressedNormal, 8, 8)) / 255.0f * 2.0f - 1.0f;
+	vec3 n = vec3(f, 1.0f - abs(f.x) - abs(f.y));
+	float t = max(-n.z, 0.0f);
+	n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0f)));
+	return normalize(n);
+}
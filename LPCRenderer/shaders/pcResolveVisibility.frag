@@ -0,0 +1,23 @@
+#version 460 core
+
+//one or two words per pixel, written by the rasterizer, the colour in the first of two
+layout(std430, binding = 3) restrict readonly buffer Visibility
+{
+	uint visibility[];
+};
+
+uniform ivec2 resolution;
+uniform int visibilityWords;
+uniform vec3 diffuseColor;
+out vec4 fragColor;
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	uint index = (pixel.y * resolution.x + pixel.x) * visibilityWords;
+	uint invertedDepth = visibility[index + visibilityWords - 1];
+	if(invertedDepth == 0)
+		discard;
+	fragColor = visibilityWords == 2 ? unpackUnorm4x8(visibility[index]) : vec4(diffuseColor, 1.0f);
+	gl_FragDepth = uintBitsToFloat(0xFFFFFFFFu - invertedDepth);
+}
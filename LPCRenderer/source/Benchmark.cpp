@@ -0,0 +1,493 @@
+#include "Benchmark.h"
+#include "PCManager.h"
+#include "SceneManager.h"
+#include "Profiler.h"
+#include "Parallel.h"
+#include "NormalEncoding.h"
+#include "Shader.h"
+#include "PCRendererUncompressed.h"
+#include "PCRendererBrickGS.h"
+#include "PCRendererBrickExpansion.h"
+#include "PCRendererBrickIndirect.h"
+#include "PCRendererBitmap.h"
+#include "PCRendererDelta.h"
+#include "PCRendererRasterizer.h"
+#include "glad/glad.h"
+#include "glm/gtc/constants.hpp"
+#include "imgui.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct UpdateResult
+	{
+		std::string renderer;
+		std::chrono::nanoseconds duration;
+		std::size_t residentBytesIncrease;
+		std::size_t peakResidentBytesIncrease;
+		std::size_t gpuBytes;
+	};
+
+	std::vector<std::pair<std::string, std::function<std::unique_ptr<PCRenderer>()>>> const renderers = {
+		{"None", []() -> std::unique_ptr<PCRenderer> { return std::make_unique<PCRendererUncompressed>(); }},
+		{"Brick Geometry Shader", []() -> std::unique_ptr<PCRenderer> { return std::make_unique<PCRendererBrickGS>(); }},
+		{"Brick Compute Expansion", []() -> std::unique_ptr<PCRenderer> { return std::make_unique<PCRendererBrickExpansion>(); }},
+		{"Brick Indirect Draw", []() -> std::unique_ptr<PCRenderer> { return std::make_unique<PCRendererBrickIndirect>(); }},
+		{"Bitmap", []() -> std::unique_ptr<PCRenderer> { return std::make_unique<PCRendererBitmap>(); }},
+		{"Delta Coded", []() -> std::unique_ptr<PCRenderer> { return std::make_unique<PCRendererDelta>(); }},
+		{"Compute Rasterizer", []() -> std::unique_ptr<PCRenderer> { return std::make_unique<PCRendererRasterizer>(); }}
+	};
+	//polls the resident set while a renderer updates, the process high-water mark would only ever grow
+	class ResidentSampler
+	{
+	private:
+		std::atomic<bool> running{true};
+		std::atomic<std::size_t> peakBytes;
+		std::thread thread;
+
+	public:
+		ResidentSampler()
+			:peakBytes(Profiler::getResidentBytes())
+		{
+			thread = std::thread{[this]() {
+				while(running)
+				{
+					sample();
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			}};
+		}
+
+		~ResidentSampler()
+		{
+			running = false;
+			thread.join();
+		}
+
+		void sample()
+		{
+			std::size_t bytes = Profiler::getResidentBytes();
+			std::size_t peak = peakBytes;
+			while(bytes > peak && !peakBytes.compare_exchange_weak(peak, bytes));
+		}
+
+		std::size_t getPeakBytes()
+		{
+			sample();
+			return peakBytes;
+		}
+	};
+
+	std::vector<UpdateResult> updateResults;
+	std::string benchmarkedCloud;
+	struct NormalEncodingResult
+	{
+		std::string format;
+		int bits = 0;
+		std::chrono::nanoseconds duration{0};
+		double meanError = 0.0;
+		double maxError = 0.0;
+	};
+
+	struct RenderResult
+	{
+		std::string renderer;
+		std::chrono::nanoseconds frameTime;
+	};
+
+	//the renderers that expand bricks on the GPU, drawn from the active camera
+	std::vector<std::string> const throughputRenderers = {"Brick Geometry Shader", "Brick Compute Expansion", "Brick Indirect Draw"};
+	std::vector<RenderResult> renderResults;
+	std::string renderBenchmarkedCloud;
+	std::size_t renderBenchmarkedCount = 0;
+	int renderFrames = 20;
+
+	std::vector<PCRendererBitmap::UnpackTiming> unpackTimings;
+	std::string unpackBenchmarkedCloud;
+	int unpackRepetitions = 10;
+	std::vector<NormalEncodingResult> normalEncodingResults;
+	std::string normalBenchmarkedCloud;
+	std::size_t normalBenchmarkedCount = 0;
+	int syntheticPointCount = 100'000'000;
+	bool syntheticNormals = true;
+	bool syntheticColors = true;
+
+	void runUpdateBenchmark(PointCloud const* cloud)
+	{
+		updateResults.clear();
+		benchmarkedCloud = cloud->getName();
+		for(auto const& [name, makeRenderer] : renderers)
+		{
+			auto renderer = makeRenderer();
+			//otherwise every renderer after the first one sharing a stream would only be timed uploading it
+			cloud->clearPackedStreams();
+			std::size_t gpuBytesBefore = Profiler::getGPUAllocatedBytes();
+			std::size_t residentBytesBefore = Profiler::getResidentBytes();
+			std::size_t peakResidentBytes = 0;
+			std::chrono::nanoseconds duration;
+			{
+				ResidentSampler sampler;
+				auto start = std::chrono::steady_clock::now();
+				renderer->setPointCloud(cloud);
+				glFinish();
+				duration = std::chrono::steady_clock::now() - start;
+				peakResidentBytes = sampler.getPeakBytes();
+			}
+
+			UpdateResult result;
+			result.renderer = name;
+			result.duration = duration;
+			std::size_t residentBytesAfter = Profiler::getResidentBytes();
+			result.residentBytesIncrease = residentBytesAfter > residentBytesBefore ? residentBytesAfter - residentBytesBefore : 0;
+			result.peakResidentBytesIncrease = peakResidentBytes - std::min(peakResidentBytes, residentBytesBefore);
+			result.gpuBytes = Profiler::getGPUAllocatedBytes() - gpuBytesBefore;
+			updateResults.push_back(std::move(result));
+		}
+	}
+
+	//angular error in degrees between the normals and their decoded encodings
+	template<typename Decode>
+	void measureNormalError(Span<glm::vec3 const> normals, Decode&& decode, NormalEncodingResult& result)
+	{
+		std::size_t workerCount = getWorkerCount();
+		std::vector<double> errorSums(workerCount, 0.0);
+		std::vector<double> errorMaxima(workerCount, 0.0);
+		parallelFor(workerCount, normals.size(), [&](std::size_t worker, std::size_t begin, std::size_t end) {
+			for(std::size_t idx = begin; idx < end; idx++)
+			{
+				float cosine = glm::dot(glm::normalize(normals[idx]), decode(idx));
+				double error = glm::degrees(std::acos(glm::clamp(cosine, -1.0f, 1.0f)));
+				errorSums[worker] += error;
+				errorMaxima[worker] = std::max(errorMaxima[worker], error);
+			}
+		});
+		double errorSum = 0.0;
+		result.maxError = 0.0;
+		for(std::size_t worker = 0; worker < workerCount; worker++)
+		{
+			errorSum += errorSums[worker];
+			result.maxError = std::max(result.maxError, errorMaxima[worker]);
+		}
+		result.meanError = errorSum / std::max<std::size_t>(normals.size(), 1);
+	}
+
+	void runNormalEncodingBenchmark(PointCloud const* cloud)
+	{
+		normalEncodingResults.clear();
+		normalBenchmarkedCloud = cloud->getName();
+		auto normals = cloud->getNormals();
+		normalBenchmarkedCount = normals.size();
+
+		//every format is encoded on all workers, like the packed streams of the renderers
+		for(int componentSize : {16, 8})
+		{
+			NormalEncodingResult result{"Spherical", 2 * componentSize};
+			std::vector<std::uint32_t> packed(normals.size());
+			auto start = std::chrono::steady_clock::now();
+			parallelFor(getWorkerCount(), normals.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+				for(std::size_t idx = begin; idx < end; idx++)
+					packed[idx] = componentSize == 16 ? toSpherical16(normals[idx]) : toSpherical8(normals[idx]);
+			});
+			result.duration = std::chrono::steady_clock::now() - start;
+			measureNormalError(normals, [&](std::size_t idx) { return fromSpherical(packed[idx], componentSize); }, result);
+			normalEncodingResults.push_back(std::move(result));
+		}
+		for(int size : {24, 16, 12, 8})
+		{
+			NormalEncodingResult result{"Octahedral", size};
+			auto start = std::chrono::steady_clock::now();
+			auto packed = toOctahedral<std::uint32_t>(normals, size / 2);
+			result.duration = std::chrono::steady_clock::now() - start;
+			measureNormalError(normals, [&](std::size_t idx) { return fromOctahedral(packed[idx], size / 2); }, result);
+			normalEncodingResults.push_back(std::move(result));
+		}
+	}
+
+	//GPU time of whole frames, set up the same way the main renderer does it
+	void runRenderBenchmark(Scene const* scene)
+	{
+		renderResults.clear();
+		renderBenchmarkedCloud = scene->getPointCloud()->getName();
+		renderBenchmarkedCount = scene->getPointCloud()->getPositions().size();
+
+		GLuint query;
+		glGenQueries(1, &query);
+		for(auto const& [name, makeRenderer] : renderers)
+		{
+			if(std::find(throughputRenderers.begin(), throughputRenderers.end(), name) == throughputRenderers.end())
+				continue;
+			auto renderer = makeRenderer();
+			auto renderFrame = [&]() {
+				Shader* shader = renderer->getMainShader();
+				shader->use();
+				shader->set("model", scene->getModelMatrix());
+				shader->set("view", scene->getCamera().getViewMatrix());
+				shader->set("projection", scene->getCamera().getProjectionMatrix());
+				shader->set("diffuseColor", scene->getDiffuseColor());
+				renderer->render(scene);
+			};
+			//the first frame uploads the streams
+			renderFrame();
+			glFinish();
+
+			glBeginQuery(GL_TIME_ELAPSED, query);
+			for(int frame = 0; frame < renderFrames; frame++)
+				renderFrame();
+			glEndQuery(GL_TIME_ELAPSED);
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			renderResults.push_back({name, std::chrono::nanoseconds(elapsed / renderFrames)});
+		}
+		glDeleteQueries(1, &query);
+	}
+
+	void runUnpackBenchmark(PointCloud const* cloud)
+	{
+		unpackBenchmarkedCloud = cloud->getName();
+		PCRendererBitmap renderer;
+		renderer.setPointCloud(cloud);
+		unpackTimings = renderer.benchmarkUnpacking(unpackRepetitions);
+	}
+
+	void drawUpdateBenchmark()
+	{
+		Scene const* scene = SceneManager::getActive();
+		if(!scene || !scene->getPointCloud())
+		{
+			ImGui::Text("No active point cloud");
+			return;
+		}
+		PointCloud const* cloud = scene->getPointCloud();
+		glm::ivec3 subdivisions = cloud->getSubdivisions();
+		ImGui::Text("Active: %s, subdivisions %i, %i, %i", cloud->getName().data(), subdivisions.x, subdivisions.y, subdivisions.z);
+		if(ImGui::Button("Run"))
+			runUpdateBenchmark(cloud);
+		ImGui::SameLine();
+		ImGui::Text("Drops the packed streams of the cloud, so every renderer packs its own");
+		if(updateResults.empty())
+			return;
+
+		ImGui::Text("Results for %s", benchmarkedCloud.data());
+		ImGui::Columns(5);
+		ImGui::Text("Renderer");
+		ImGui::NextColumn();
+		ImGui::Text("Update");
+		ImGui::NextColumn();
+		ImGui::Text("RSS Increase");
+		ImGui::NextColumn();
+		ImGui::Text("Peak RSS Increase");
+		ImGui::NextColumn();
+		ImGui::Text("GPU Memory");
+		ImGui::NextColumn();
+		ImGui::Separator();
+		for(auto const& result : updateResults)
+		{
+			ImGui::Text("%s", result.renderer.data());
+			ImGui::NextColumn();
+			ImGui::Text("%.2f ms", std::chrono::duration<float, std::milli>(result.duration).count());
+			ImGui::NextColumn();
+			drawMemoryConsumption(result.residentBytesIncrease);
+			ImGui::NextColumn();
+			drawMemoryConsumption(result.peakResidentBytesIncrease);
+			ImGui::NextColumn();
+			drawMemoryConsumption(result.gpuBytes);
+			ImGui::NextColumn();
+		}
+		ImGui::Columns();
+	}
+
+	void drawRenderBenchmark()
+	{
+		Scene const* scene = SceneManager::getActive();
+		if(!scene || !scene->getPointCloud())
+		{
+			ImGui::Text("No active point cloud");
+			return;
+		}
+		ImGui::InputInt("Frames", &renderFrames, 1, 10);
+		if(renderFrames < 1)
+			renderFrames = 1;
+		if(ImGui::Button("Run##Rendering"))
+			runRenderBenchmark(scene);
+		if(!renderResults.empty())
+		{
+			ImGui::Text("GPU time per frame for %s, %zu points, current camera", renderBenchmarkedCloud.data(), renderBenchmarkedCount);
+			ImGui::Columns(3);
+			ImGui::Text("Renderer");
+			ImGui::NextColumn();
+			ImGui::Text("Frame");
+			ImGui::NextColumn();
+			ImGui::Text("Throughput");
+			ImGui::NextColumn();
+			ImGui::Separator();
+			for(auto const& result : renderResults)
+			{
+				float milliseconds = std::chrono::duration<float, std::milli>(result.frameTime).count();
+				ImGui::Text("%s", result.renderer.data());
+				ImGui::NextColumn();
+				ImGui::Text("%.3f ms", milliseconds);
+				ImGui::NextColumn();
+				ImGui::Text("%.0f M points/s", renderBenchmarkedCount / std::max(milliseconds, 1e-3f) / 1000.0f);
+				ImGui::NextColumn();
+			}
+			ImGui::Columns();
+		}
+	}
+
+	void drawUnpackBenchmark()
+	{
+		Scene const* scene = SceneManager::getActive();
+		if(!scene || !scene->getPointCloud())
+		{
+			ImGui::Text("No active point cloud");
+			return;
+		}
+		ImGui::InputInt("Repetitions", &unpackRepetitions, 1, 10);
+		if(unpackRepetitions < 1)
+			unpackRepetitions = 1;
+		if(ImGui::Button("Run##Unpacking"))
+			runUnpackBenchmark(scene->getPointCloud());
+		if(unpackTimings.empty())
+			return;
+
+		ImGui::Text("GPU time per frame for %s", unpackBenchmarkedCloud.data());
+		ImGui::Columns(4);
+		ImGui::Text("Bitmap Size");
+		ImGui::NextColumn();
+		ImGui::Text("Atomic");
+		ImGui::NextColumn();
+		ImGui::Text("Prefix Sum");
+		ImGui::NextColumn();
+		ImGui::Text("Speedup");
+		ImGui::NextColumn();
+		ImGui::Separator();
+		for(auto const& timing : unpackTimings)
+		{
+			float atomic = std::chrono::duration<float, std::milli>(timing.atomic).count();
+			float scan = std::chrono::duration<float, std::milli>(timing.scan).count();
+			ImGui::Text("%i", timing.bitmapSize);
+			ImGui::NextColumn();
+			ImGui::Text("%.3f ms", atomic);
+			ImGui::NextColumn();
+			ImGui::Text("%.3f ms", scan);
+			ImGui::NextColumn();
+			ImGui::Text("%.2fx", scan > 0.0f ? atomic / scan : 0.0f);
+			ImGui::NextColumn();
+		}
+		ImGui::Columns();
+	}
+
+	void drawNormalEncodingBenchmark()
+	{
+		Scene const* scene = SceneManager::getActive();
+		if(!scene || !scene->getPointCloud() || !scene->getPointCloud()->hasNormals())
+		{
+			ImGui::Text("No active point cloud with normals");
+			return;
+		}
+		if(ImGui::Button("Run##NormalEncoding"))
+			runNormalEncodingBenchmark(scene->getPointCloud());
+		if(normalEncodingResults.empty())
+			return;
+
+		ImGui::Text("Results for %s, %zu normals", normalBenchmarkedCloud.data(), normalBenchmarkedCount);
+		ImGui::Columns(5);
+		ImGui::Text("Format");
+		ImGui::NextColumn();
+		ImGui::Text("Bits");
+		ImGui::NextColumn();
+		ImGui::Text("Encode");
+		ImGui::NextColumn();
+		ImGui::Text("Mean Error");
+		ImGui::NextColumn();
+		ImGui::Text("Max Error");
+		ImGui::NextColumn();
+		ImGui::Separator();
+		for(auto const& result : normalEncodingResults)
+		{
+			float milliseconds = std::chrono::duration<float, std::milli>(result.duration).count();
+			ImGui::Text("%s", result.format.data());
+			ImGui::NextColumn();
+			ImGui::Text("%i", result.bits);
+			ImGui::NextColumn();
+			ImGui::Text("%.2f ms (%.0f M/s)", milliseconds, normalBenchmarkedCount / std::max(milliseconds, 1e-3f) / 1000.0f);
+			ImGui::NextColumn();
+			ImGui::Text("%.4f deg", result.meanError);
+			ImGui::NextColumn();
+			ImGui::Text("%.4f deg", result.maxError);
+			ImGui::NextColumn();
+		}
+		ImGui::Columns();
+	}
+}
+
+std::unique_ptr<PointCloud> Benchmark::generateSyntheticCloud(std::size_t pointCount, bool withNormals, bool withColors)
+{
+	std::vector<glm::vec3> positions(pointCount);
+	std::vector<glm::vec3> normals(withNormals ? pointCount : 0);
+	std::vector<glm::u8vec3> colors(withColors ? pointCount : 0);
+
+	//a slightly noisy sphere shell, dense enough to resemble a scanned surface
+	parallelFor(getWorkerCount(), pointCount, [&](std::size_t worker, std::size_t begin, std::size_t end) {
+		std::mt19937 generator(static_cast<unsigned int>(worker));
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::normal_distribution<float> noise(0.0f, 0.005f);
+		for(std::size_t i = begin; i < end; i++)
+		{
+			float z = 2.0f * unit(generator) - 1.0f;
+			float phi = 2.0f * glm::pi<float>() * unit(generator);
+			float r = std::sqrt(1.0f - z * z);
+			glm::vec3 direction{r * std::cos(phi), r * std::sin(phi), z};
+			positions[i] = direction * (1.0f + noise(generator));
+			if(withNormals)
+				normals[i] = direction;
+			if(withColors)
+				colors[i] = glm::u8vec3((direction * 0.5f + 0.5f) * 255.0f);
+		}
+	});
+	auto cloud = std::make_unique<PointCloud>(std::move(positions), std::move(normals), std::move(colors));
+	cloud->setName("Synthetic(" + std::to_string(pointCount) + ")");
+	return cloud;
+}
+
+void Benchmark::drawUI()
+{
+	if(ImGui::CollapsingHeader("Synthetic Point Cloud", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		ImGui::InputInt("Point Count", &syntheticPointCount, 1'000'000, 10'000'000);
+		if(syntheticPointCount < 1)
+			syntheticPointCount = 1;
+		ImGui::Checkbox("Normals", &syntheticNormals);
+		ImGui::SameLine();
+		ImGui::Checkbox("Colors", &syntheticColors);
+		if(ImGui::Button("Generate"))
+		{
+			auto cloud = PCManager::add(generateSyntheticCloud(syntheticPointCount, syntheticNormals, syntheticColors));
+			SceneManager::add(std::make_unique<Scene>(cloud));
+		}
+	}
+
+	ImGui::NewLine();
+	if(ImGui::CollapsingHeader("Renderer Updates", ImGuiTreeNodeFlags_DefaultOpen))
+		drawUpdateBenchmark();
+
+	ImGui::NewLine();
+	if(ImGui::CollapsingHeader("Brick Rendering Throughput", ImGuiTreeNodeFlags_DefaultOpen))
+		drawRenderBenchmark();
+
+	ImGui::NewLine();
+	if(ImGui::CollapsingHeader("Bitmap Unpacking", ImGuiTreeNodeFlags_DefaultOpen))
+		drawUnpackBenchmark();
+
+	ImGui::NewLine();
+	if(ImGui::CollapsingHeader("Normal Encoding", ImGuiTreeNodeFlags_DefaultOpen))
+		drawNormalEncodingBenchmark();
+}
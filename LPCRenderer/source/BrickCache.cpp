@@ -0,0 +1,278 @@
+#include "BrickCache.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static_assert(sizeof(std::size_t) == sizeof(std::uint64_t), "brick offsets are mapped straight from the file");
+static_assert(sizeof(glm::vec3) == 12 && sizeof(glm::u8vec3) == 3, "points are mapped straight from the file");
+
+namespace
+{
+	constexpr std::array<char, 4> magic = {'L', 'P', 'C', 'B'};
+	constexpr std::uint32_t version = 3;
+	constexpr std::uint32_t byteOrderMark = 0x01020304;
+	//every section starts on its own cache line
+	constexpr std::uint64_t sectionAlignment = 64;
+
+	//header flags
+	constexpr std::uint32_t hasNormals = 1u << 0;
+	constexpr std::uint32_t hasColors = 1u << 1;
+	//far beyond what the cloud settings allow, keeps the brick count product from overflowing
+	constexpr std::int32_t maxSubdivisions = 1 << 16;
+
+	struct FileHeader
+	{
+		std::array<char, 4> magic;
+		std::uint32_t version;
+		std::uint32_t byteOrderMark;
+		std::uint32_t flags;
+		std::array<std::int32_t, 3> subdivisions;
+		std::array<float, 3> boundsMin;
+		std::array<float, 3> boundsMax;
+		std::uint32_t padding;
+		std::uint64_t vertexCount;
+		std::uint64_t brickCount;
+		//byte offsets from the start of the file
+		std::uint64_t brickTableOffset;
+		std::uint64_t positionsOffset;
+		std::uint64_t normalsOffset;
+		std::uint64_t colorsOffset;
+		std::uint64_t packedStreamTableOffset;
+		std::uint64_t packedStreamCount;
+	};
+
+	//renderer payloads stored next to the points, see PackedStreamKey
+	struct PackedStreamEntry
+	{
+		std::array<char, 32> name;
+		std::array<std::int32_t, 3> subdivisions;
+		std::int32_t positionBits;
+		std::int32_t normalBits;
+		std::int32_t bitmapSize;
+		std::uint32_t errorBits;
+		std::uint32_t padding;
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+	std::uint64_t alignSection(std::uint64_t offset)
+	{
+		return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+	}
+
+	//written so that corrupt offsets and counts cannot wrap around
+	bool fitsInFile(std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize, std::uint64_t fileSize)
+	{
+		return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+	}
+}
+
+bool BrickCache::save(PointCloud const& cloud, std::filesystem::path const& filename)
+{
+	auto brickOffsets = cloud.getBrickOffsets();
+	auto positions = cloud.getPositions();
+	auto normals = cloud.getNormals();
+	auto colors = cloud.getColors();
+	auto bounds = cloud.getBounds();
+
+	FileHeader header{};
+	header.magic = magic;
+	header.version = version;
+	header.byteOrderMark = byteOrderMark;
+	header.flags = (cloud.hasNormals() ? hasNormals : 0u) | (cloud.hasColors() ? hasColors : 0u);
+	for(int i = 0; i < 3; i++)
+	{
+		header.subdivisions[i] = cloud.getSubdivisions()[i];
+		header.boundsMin[i] = bounds.first[i];
+		header.boundsMax[i] = bounds.second[i];
+	}
+	header.vertexCount = positions.size();
+	header.brickCount = cloud.getBrickCount();
+	header.brickTableOffset = alignSection(sizeof(FileHeader));
+	header.positionsOffset = alignSection(header.brickTableOffset + brickOffsets.sizeInBytes());
+	header.normalsOffset = alignSection(header.positionsOffset + positions.sizeInBytes());
+	header.colorsOffset = alignSection(header.normalsOffset + normals.sizeInBytes());
+	header.packedStreamTableOffset = alignSection(header.colorsOffset + colors.sizeInBytes());
+	//streams of other subdivisions would never be used by the saved bricks
+	std::vector<std::pair<PackedStreamKey const*, PackedStream const*>> packedStreams;
+	for(auto const& [key, stream] : cloud.getPackedStreams())
+	{
+		if(key.subdivisions != cloud.getSubdivisions())
+			continue;
+		//the stream is only lost from the cache, the renderer packs it again when needed
+		if(key.name.size() >= sizeof(PackedStreamEntry::name))
+		{
+			std::cerr << "Packed stream name " + key.name + " is too long for the brick cache, skipping it\n";
+			continue;
+		}
+		packedStreams.emplace_back(&key, &stream);
+	}
+	header.packedStreamCount = packedStreams.size();
+
+	std::vector<PackedStreamEntry> packedStreamTable;
+	std::uint64_t packedStreamOffset = header.packedStreamTableOffset + header.packedStreamCount * sizeof(PackedStreamEntry);
+	for(auto [keyPointer, streamPointer] : packedStreams)
+	{
+		PackedStreamKey const& key = *keyPointer;
+		PackedStream const& stream = *streamPointer;
+		PackedStreamEntry entry{};
+		std::copy(key.name.begin(), key.name.end(), entry.name.begin());
+		for(int i = 0; i < 3; i++)
+			entry.subdivisions[i] = key.subdivisions[i];
+		entry.positionBits = key.positionBits;
+		entry.normalBits = key.normalBits;
+		entry.bitmapSize = key.bitmapSize;
+		entry.errorBits = key.errorBits;
+		entry.offset = alignSection(packedStreamOffset);
+		entry.size = stream.data.size();
+		packedStreamOffset = entry.offset + entry.size;
+		packedStreamTable.push_back(entry);
+	}
+
+	//written next to the target and renamed over it, a loaded cloud may still map the old file as its points
+	std::filesystem::path temporaryFilename = filename;
+	temporaryFilename += ".tmp";
+	std::ofstream file{temporaryFilename, std::ios::binary | std::ios::trunc};
+	if(file.fail())
+	{
+		std::cerr << "Failed to open " + temporaryFilename.string() + " for writing\n";
+		return false;
+	}
+	std::error_code error;
+	auto writeSection = [&](std::uint64_t offset, void const* data, std::size_t size) {
+		std::array<char, sectionAlignment> zeros{};
+		file.write(zeros.data(), offset - static_cast<std::uint64_t>(file.tellp()));
+		file.write(static_cast<char const*>(data), size);
+	};
+	file.write(reinterpret_cast<char const*>(&header), sizeof(FileHeader));
+	writeSection(header.brickTableOffset, brickOffsets.data(), brickOffsets.sizeInBytes());
+	writeSection(header.positionsOffset, positions.data(), positions.sizeInBytes());
+	writeSection(header.normalsOffset, normals.data(), normals.sizeInBytes());
+	writeSection(header.colorsOffset, colors.data(), colors.sizeInBytes());
+	writeSection(header.packedStreamTableOffset, packedStreamTable.data(), packedStreamTable.size() * sizeof(PackedStreamEntry));
+	std::size_t entryIndex = 0;
+	for(auto [key, stream] : packedStreams)
+		writeSection(packedStreamTable[entryIndex++].offset, stream->data.data(), stream->data.size());
+	file.close();
+	if(file.fail())
+	{
+		std::cerr << "Failed to write " + temporaryFilename.string() + "\n";
+		std::filesystem::remove(temporaryFilename, error);
+		return false;
+	}
+	//the old file stays valid for whoever maps it, where that keeps it from being replaced the save fails instead
+	std::filesystem::rename(temporaryFilename, filename, error);
+	if(error)
+	{
+		std::cerr << "Failed to replace " + filename.string() + ", it may be mapped by a loaded cloud: " + error.message() + "\n";
+		std::filesystem::remove(temporaryFilename, error);
+		return false;
+	}
+	return true;
+}
+
+std::unique_ptr<PointCloud> BrickCache::load(std::filesystem::path const& filename)
+{
+	auto file = std::make_shared<MappedFile>(filename);
+	if(!file->isOpen() || file->size() < sizeof(FileHeader))
+	{
+		std::cerr << "Failed to open " + filename.string() + "\n";
+		return nullptr;
+	}
+	FileHeader header;
+	std::memcpy(&header, file->data(), sizeof(FileHeader));
+	if(header.magic != magic || header.byteOrderMark != byteOrderMark)
+	{
+		std::cerr << filename.string() + " is not a brick cache of this platform\n";
+		return nullptr;
+	}
+	if(header.version != version)
+	{
+		std::cerr << filename.string() + " has brick cache version " + std::to_string(header.version)
+			+ ", expected " + std::to_string(version) + "\n";
+		return nullptr;
+	}
+
+	for(auto subdivisions : header.subdivisions)
+	{
+		if(subdivisions < 0 || subdivisions > maxSubdivisions)
+		{
+			std::cerr << filename.string() + " has invalid subdivisions\n";
+			return nullptr;
+		}
+	}
+	std::uint64_t normalCount = header.flags & hasNormals ? header.vertexCount : 0;
+	std::uint64_t colorCount = header.flags & hasColors ? header.vertexCount : 0;
+	std::uint64_t brickCount = std::uint64_t(header.subdivisions[0] + 1) * (header.subdivisions[1] + 1) * (header.subdivisions[2] + 1);
+	std::uint64_t fileSize = file->size();
+	if(header.brickCount != brickCount
+		|| !fitsInFile(header.brickTableOffset, brickCount + 1, sizeof(std::uint64_t), fileSize)
+		|| !fitsInFile(header.positionsOffset, header.vertexCount, sizeof(glm::vec3), fileSize)
+		|| !fitsInFile(header.normalsOffset, normalCount, sizeof(glm::vec3), fileSize)
+		|| !fitsInFile(header.colorsOffset, colorCount, sizeof(glm::u8vec3), fileSize)
+		|| !fitsInFile(header.packedStreamTableOffset, header.packedStreamCount, sizeof(PackedStreamEntry), fileSize))
+	{
+		std::cerr << filename.string() + " is truncated\n";
+		return nullptr;
+	}
+	if(header.brickTableOffset % alignof(std::uint64_t) != 0 || header.positionsOffset % alignof(glm::vec3) != 0 || header.normalsOffset % alignof(glm::vec3) != 0)
+	{
+		std::cerr << filename.string() + " has misaligned sections\n";
+		return nullptr;
+	}
+
+	//every brick is a range of the points, a broken table would send the renderers out of bounds
+	std::byte const* data = file->data();
+	std::uint64_t const* brickTable = reinterpret_cast<std::uint64_t const*>(data + header.brickTableOffset);
+	bool validBrickTable = brickTable[0] == 0 && brickTable[brickCount] == header.vertexCount;
+	for(std::uint64_t brick = 0; validBrickTable && brick < brickCount; brick++)
+		validBrickTable = brickTable[brick] <= brickTable[brick + 1];
+	if(!validBrickTable)
+	{
+		std::cerr << filename.string() + " has an invalid brick table\n";
+		return nullptr;
+	}
+
+	PointCloudStorage storage;
+	for(int i = 0; i < 3; i++)
+	{
+		storage.subdivisions[i] = header.subdivisions[i];
+		storage.bounds.first[i] = header.boundsMin[i];
+		storage.bounds.second[i] = header.boundsMax[i];
+	}
+	storage.brickOffsets = {reinterpret_cast<std::size_t const*>(data + header.brickTableOffset), brickCount + 1};
+	storage.positions = {reinterpret_cast<glm::vec3 const*>(data + header.positionsOffset), header.vertexCount};
+	storage.normals = {reinterpret_cast<glm::vec3 const*>(data + header.normalsOffset), normalCount};
+	storage.colors = {reinterpret_cast<glm::u8vec3 const*>(data + header.colorsOffset), colorCount};
+	for(std::uint64_t i = 0; i < header.packedStreamCount; i++)
+	{
+		PackedStreamEntry entry;
+		std::memcpy(&entry, data + header.packedStreamTableOffset + i * sizeof(PackedStreamEntry), sizeof(PackedStreamEntry));
+		entry.name.back() = '\0';
+		//only the stream is lost, the renderer packs it again, its contents are checked by the renderer on first use
+		glm::ivec3 entrySubdivisions{entry.subdivisions[0], entry.subdivisions[1], entry.subdivisions[2]};
+		if(!fitsInFile(entry.offset, entry.size, 1, fileSize) || entry.offset % sectionAlignment != 0
+			|| entrySubdivisions != glm::ivec3(header.subdivisions[0], header.subdivisions[1], header.subdivisions[2]))
+		{
+			std::cerr << "Dropping the invalid packed stream " + std::string(entry.name.data()) + " of " + filename.string() + "\n";
+			continue;
+		}
+		PackedStreamKey key;
+		key.name = entry.name.data();
+		key.subdivisions = entrySubdivisions;
+		key.positionBits = entry.positionBits;
+		key.normalBits = entry.normalBits;
+		key.bitmapSize = entry.bitmapSize;
+		key.errorBits = entry.errorBits;
+		storage.packedStreams[key] = PackedStream{{data + entry.offset, entry.size}, file};
+	}
+	storage.mapping = file.get();
+	storage.owner = std::move(file);
+	return std::make_unique<PointCloud>(std::move(storage));
+}
@@ -0,0 +1,296 @@
+#include "BrickResidency.h"
+#include "Frustum.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+namespace
+{
+	//loads in flight, bounded so a camera jump does not queue up the whole cloud
+	constexpr std::size_t maxPendingLoads = 16;
+
+	std::size_t getPointSize(BrickResidency::StreamLayout const& layout)
+	{
+		std::size_t pointSize = 0;
+		for(auto size : layout)
+			pointSize += size;
+		return pointSize;
+	}
+}
+
+BrickResidency::BrickResidency(PointCloud const* cloud, StreamLayout layout, Packer packer, Budgets budgets)
+	:cloud(cloud), layout(layout), packer(std::move(packer)), budgets(budgets)
+{
+	pageCount = budgets.gpuBytes / std::max<std::size_t>(1, pagePointCount * getPointSize(layout));
+	if(pageCount == 0)
+		return;
+	for(std::size_t stream = 0; stream < streamCount; stream++)
+	{
+		if(layout[stream] != 0)
+			pools[stream].reserve(pageCount * pagePointCount * layout[stream], GL_DYNAMIC_STORAGE_BIT);
+	}
+	//a brick that starts below the upload budget may overshoot it, a page of every stream is spare room for that
+	stagingBuffer.reserveStreaming(budgets.uploadBytesPerFrame + pagePointCount * getPointSize(layout) + 4 * streamCount);
+	drawBuffer.reserveStreaming(pageCount * sizeof(DrawCommand));
+	freePages.reserve(pageCount);
+	for(std::size_t page = pageCount; page > 0; page--)
+		freePages.push_back(page - 1);
+}
+
+BrickResidency::~BrickResidency()
+{
+	for(auto& [brickIndex, load] : pendingLoads)
+		load.done.wait();
+	Profiler::recordBrickResidency(0, 0, 0, 0);
+}
+
+std::size_t BrickResidency::getPageCount(std::size_t brickIndex) const
+{
+	auto brickOffsets = cloud->getBrickOffsets();
+	std::size_t pointCount = brickOffsets[brickIndex + 1] - brickOffsets[brickIndex];
+	return (pointCount + pagePointCount - 1) / pagePointCount;
+}
+
+//returns the bytes packed right away, loads from a mapped file run in the background instead
+std::size_t BrickResidency::requestLoad(std::size_t brickIndex)
+{
+	if(pendingLoads.count(brickIndex) || pendingLoads.size() >= maxPendingLoads)
+		return 0;
+
+	PointCloudBrick brick = cloud->getBrickAt(brickIndex);
+	//points that are already in host memory are packed right away
+	if(!cloud->getStorageOwner())
+		return insertHostBrick(brickIndex, packer(brick));
+
+	//the loader keeps the mapping alive on its own, the cloud may be rebricked while it runs
+	PendingLoad load;
+	load.payload = std::make_shared<BrickPayload>();
+	load.done = loaders.submit([packer = packer, brick, payload = load.payload, owner = cloud->getStorageOwner(), mapping = cloud->getStorageMapping()]() {
+		*payload = packer(brick);
+		if(mapping)
+		{
+			mapping->release(brick.positions.data(), brick.positions.sizeInBytes());
+			mapping->release(brick.normals.data(), brick.normals.sizeInBytes());
+			mapping->release(brick.colors.data(), brick.colors.sizeInBytes());
+		}
+	});
+	pendingLoads.emplace(brickIndex, std::move(load));
+	return 0;
+}
+
+void BrickResidency::collectLoads()
+{
+	for(auto load = pendingLoads.begin(); load != pendingLoads.end();)
+	{
+		if(load->second.done.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++load;
+			continue;
+		}
+		load->second.done.get();
+		insertHostBrick(load->first, std::move(*load->second.payload));
+		load = pendingLoads.erase(load);
+	}
+}
+
+std::size_t BrickResidency::insertHostBrick(std::size_t brickIndex, BrickPayload&& payload)
+{
+	std::size_t size = 0;
+	for(auto const& stream : payload)
+		size += stream.size();
+
+	while(!hostLRU.empty() && hostBytes + size > budgets.hostBytes)
+	{
+		auto evicted = hostBricks.find(hostLRU.back());
+		hostBytes -= evicted->second.size;
+		hostBricks.erase(evicted);
+		hostLRU.pop_back();
+		Profiler::recordBrickEviction(false);
+	}
+
+	hostLRU.push_front(brickIndex);
+	HostBrick& hostBrick = hostBricks[brickIndex];
+	hostBrick.payload = std::move(payload);
+	hostBrick.size = size;
+	hostBrick.lruPosition = hostLRU.begin();
+	hostBytes += size;
+	Profiler::recordBrickPageIn(size);
+	return size;
+}
+
+BrickResidency::HostBrick* BrickResidency::findHostBrick(std::size_t brickIndex)
+{
+	auto hostBrick = hostBricks.find(brickIndex);
+	if(hostBrick == hostBricks.end())
+		return nullptr;
+	hostLRU.splice(hostLRU.begin(), hostLRU, hostBrick->second.lruPosition);
+	return &hostBrick->second;
+}
+
+bool BrickResidency::upload(std::size_t brickIndex, HostBrick const& hostBrick)
+{
+	std::size_t brickPageCount = getPageCount(brickIndex);
+	while(freePages.size() < brickPageCount)
+	{
+		//the least recently used brick that is not drawn this frame
+		auto evicted = gpuBricks.end();
+		for(auto gpuBrick = gpuBricks.begin(); gpuBrick != gpuBricks.end(); ++gpuBrick)
+		{
+			if(gpuBrick->second.lastUsedFrame < frame && (evicted == gpuBricks.end() || gpuBrick->second.lastUsedFrame < evicted->second.lastUsedFrame))
+				evicted = gpuBrick;
+		}
+		if(evicted == gpuBricks.end())
+			return false;
+		freePages.insert(freePages.end(), evicted->second.pages.begin(), evicted->second.pages.end());
+		gpuBricks.erase(evicted);
+		Profiler::recordBrickEviction(true);
+	}
+
+	auto brickOffsets = cloud->getBrickOffsets();
+	std::size_t pointCount = brickOffsets[brickIndex + 1] - brickOffsets[brickIndex];
+	GPUBrick gpuBrick;
+	gpuBrick.lastUsedFrame = frame;
+	for(std::size_t page = 0; page < brickPageCount; page++)
+	{
+		std::size_t poolPage = freePages.back();
+		freePages.pop_back();
+		gpuBrick.pages.push_back(poolPage);
+		std::size_t first = page * pagePointCount;
+		std::size_t count = std::min(pagePointCount, pointCount - first);
+		for(std::size_t stream = 0; stream < streamCount; stream++)
+		{
+			if(layout[stream] == 0)
+				continue;
+			std::size_t poolOffset = poolPage * pagePointCount * layout[stream];
+			std::byte const* data = hostBrick.payload[stream].data() + first * layout[stream];
+			std::size_t size = count * layout[stream];
+			//only a brick far larger than the budget runs out of staging space
+			if(auto stagingOffset = stagingBuffer.allocate(size))
+			{
+				stagingBuffer.writeMapped(*stagingOffset, data, size);
+				pools[stream].copy(stagingBuffer, *stagingOffset, poolOffset, size);
+			}
+			else
+				pools[stream].update(poolOffset, data, size);
+		}
+	}
+	gpuBricks.emplace(brickIndex, std::move(gpuBrick));
+	Profiler::recordBrickUpload(hostBrick.size);
+	return true;
+}
+
+void BrickResidency::update(glm::mat4 const& modelViewProjection, glm::vec3 cameraPosition)
+{
+	frame++;
+	collectLoads();
+	if(pageCount != 0)
+	{
+		stagingBuffer.advanceRegion();
+		drawBuffer.advanceRegion();
+	}
+
+	auto brickOffsets = cloud->getBrickOffsets();
+	std::vector<std::pair<float, std::size_t>> visibleBricks;
+	for(std::size_t brickIndex = 0; brickIndex < cloud->getBrickCount(); brickIndex++)
+	{
+		if(brickOffsets[brickIndex] == brickOffsets[brickIndex + 1])
+			continue;
+		auto bounds = cloud->getBoundsAt(cloud->getBrickAt(brickIndex).indices);
+		if(isOutsideFrustum(modelViewProjection, bounds))
+			continue;
+		visibleBricks.emplace_back(glm::distance(cameraPosition, (bounds.first + bounds.second) * 0.5f), brickIndex);
+	}
+	std::sort(visibleBricks.begin(), visibleBricks.end());
+
+	//the closest visible bricks that fit into the pool form the working set, resident ones are claimed first
+	//so the uploads below never evict a brick that is drawn this frame
+	std::vector<std::size_t> workingSet;
+	std::size_t workingSetPages = 0;
+	for(auto [distance, brickIndex] : visibleBricks)
+	{
+		std::size_t brickPageCount = getPageCount(brickIndex);
+		if(workingSetPages + brickPageCount > pageCount)
+			break;
+		workingSetPages += brickPageCount;
+		workingSet.push_back(brickIndex);
+		auto gpuBrick = gpuBricks.find(brickIndex);
+		if(gpuBrick != gpuBricks.end())
+			gpuBrick->second.lastUsedFrame = frame;
+	}
+
+	std::size_t packedBytes = 0;
+	std::size_t uploadedBytes = 0;
+	for(auto brickIndex : workingSet)
+	{
+		if(gpuBricks.count(brickIndex))
+			continue;
+		HostBrick* hostBrick = findHostBrick(brickIndex);
+		if(!hostBrick)
+		{
+			if(packedBytes < budgets.uploadBytesPerFrame)
+				packedBytes += requestLoad(brickIndex);
+			continue;
+		}
+		if(uploadedBytes < budgets.uploadBytesPerFrame && upload(brickIndex, *hostBrick))
+			uploadedBytes += hostBrick->size;
+	}
+
+	std::vector<DrawCommand> drawCommands;
+	for(auto brickIndex : workingSet)
+	{
+		auto gpuBrick = gpuBricks.find(brickIndex);
+		if(gpuBrick == gpuBricks.end())
+			continue;
+		std::size_t pointCount = brickOffsets[brickIndex + 1] - brickOffsets[brickIndex];
+		for(std::size_t page = 0; page < gpuBrick->second.pages.size(); page++)
+		{
+			DrawCommand pageDrawCommand{};
+			pageDrawCommand.count = std::min(pagePointCount, pointCount - page * pagePointCount);
+			pageDrawCommand.first = gpuBrick->second.pages[page] * pagePointCount;
+			pageDrawCommand.baseInstance = brickIndex;
+			drawCommands.push_back(pageDrawCommand);
+		}
+	}
+	drawCount = drawCommands.size();
+	if(drawCount != 0)
+	{
+		drawOffset = *drawBuffer.allocate(sizeInBytes(drawCommands));
+		drawBuffer.writeMapped(drawOffset, (std::byte const*)drawCommands.data(), sizeInBytes(drawCommands));
+	}
+
+	std::size_t pageSize = pagePointCount * getPointSize(layout);
+	Profiler::recordBrickResidency(hostBytes, budgets.hostBytes, (pageCount - freePages.size()) * pageSize, pageCount * pageSize);
+}
+
+GPUBuffer const& BrickResidency::getStream(std::size_t stream) const
+{
+	return pools[stream];
+}
+
+GPUBuffer const& BrickResidency::getDrawBuffer() const
+{
+	return drawBuffer;
+}
+
+std::size_t BrickResidency::getDrawOffset() const
+{
+	return drawOffset;
+}
+
+std::size_t BrickResidency::getDrawCount() const
+{
+	return drawCount;
+}
+
+std::size_t BrickResidency::getResidentBrickCount() const
+{
+	return gpuBricks.size();
+}
+
+std::size_t BrickResidency::getPendingLoadCount() const
+{
+	return pendingLoads.size();
+}
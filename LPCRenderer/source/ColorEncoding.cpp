@@ -0,0 +1,190 @@
+#include "ColorEncoding.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	std::uint32_t toRGB565(glm::vec3 color)
+	{
+		glm::uvec3 quantized = glm::clamp(color, 0.0f, 1.0f) * glm::vec3(31.0f, 63.0f, 31.0f) + 0.5f;
+		return quantized.r << 11 | quantized.g << 5 | quantized.b;
+	}
+
+	//same as the coloured vertex shader
+	glm::vec3 fromRGB565(std::uint32_t packed)
+	{
+		return glm::vec3(packed >> 11 & 31u, packed >> 5 & 63u, packed & 31u) / glm::vec3(31.0f, 63.0f, 31.0f);
+	}
+
+	glm::u8vec3 toByte(glm::vec3 color)
+	{
+		return glm::u8vec3(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	struct BlockFit
+	{
+		std::uint32_t endpoints = 0;
+		std::array<std::uint32_t, colorBlockSize> indices{};
+		float error = std::numeric_limits<float>::max();
+	};
+
+	//picks the nearest palette entry for every point of the quantized endpoints
+	BlockFit assignIndices(glm::vec3 const* colors, std::size_t count, glm::vec3 first, glm::vec3 second, int indexBits)
+	{
+		BlockFit fit;
+		fit.endpoints = toRGB565(first) | toRGB565(second) << 16;
+		first = fromRGB565(fit.endpoints & 0xFFFF);
+		second = fromRGB565(fit.endpoints >> 16);
+		std::uint32_t levels = (1u << indexBits) - 1;
+		fit.error = 0.0f;
+		for(std::size_t point = 0; point < count; point++)
+		{
+			float bestError = std::numeric_limits<float>::max();
+			for(std::uint32_t index = 0; index <= levels; index++)
+			{
+				glm::vec3 difference = glm::mix(first, second, float(index) / levels) - colors[point];
+				float error = glm::dot(difference, difference);
+				if(error < bestError)
+				{
+					bestError = error;
+					fit.indices[point] = index;
+				}
+			}
+			fit.error += bestError;
+		}
+		return fit;
+	}
+
+	BlockFit fitBlock(glm::vec3 const* colors, std::size_t count, int indexBits)
+	{
+		glm::vec3 mean(0.0f);
+		for(std::size_t point = 0; point < count; point++)
+			mean += colors[point];
+		mean /= float(count);
+
+		//the endpoints start at the extremes along the principal axis, found by power iteration on the covariance
+		glm::mat3 covariance(0.0f);
+		for(std::size_t point = 0; point < count; point++)
+			covariance += glm::outerProduct(colors[point] - mean, colors[point] - mean);
+		glm::vec3 axis(0.299f, 0.587f, 0.114f);
+		for(int iteration = 0; iteration < 8; iteration++)
+		{
+			glm::vec3 next = covariance * axis;
+			float length = glm::length(next);
+			if(length < 1e-12f)
+				break;
+			axis = next / length;
+		}
+		float lowest = 0.0f;
+		float highest = 0.0f;
+		for(std::size_t point = 0; point < count; point++)
+		{
+			float t = glm::dot(colors[point] - mean, axis);
+			lowest = std::min(lowest, t);
+			highest = std::max(highest, t);
+		}
+		BlockFit best = assignIndices(colors, count, mean + lowest * axis, mean + highest * axis, indexBits);
+
+		//least squares refit of the endpoints to the chosen indices, kept only while it lowers the error
+		float levels = float((1u << indexBits) - 1);
+		for(int iteration = 0; iteration < 2; iteration++)
+		{
+			float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+			glm::vec3 ax(0.0f), bx(0.0f);
+			for(std::size_t point = 0; point < count; point++)
+			{
+				float b = best.indices[point] / levels;
+				float a = 1.0f - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				ax += a * colors[point];
+				bx += b * colors[point];
+			}
+			float determinant = aa * bb - ab * ab;
+			if(std::abs(determinant) < 1e-12f)
+				break;
+			glm::vec3 first = (bb * ax - ab * bx) / determinant;
+			glm::vec3 second = (aa * bx - ab * ax) / determinant;
+			BlockFit refined = assignIndices(colors, count, first, second, indexBits);
+			if(refined.error >= best.error)
+				break;
+			best = refined;
+		}
+		return best;
+	}
+}
+
+std::size_t getColorBlockWords(int indexBits)
+{
+	return 1 + std::size_t(indexBits) * colorBlockSize / 32;
+}
+
+std::vector<std::uint32_t> toColorBlocks(Span<glm::u8vec3 const> colors, int indexBits)
+{
+	std::size_t blockWords = getColorBlockWords(indexBits);
+	std::size_t blockCount = (colors.size() + colorBlockSize - 1) / colorBlockSize;
+	std::vector<std::uint32_t> blocks(blockCount * blockWords);
+	parallelFor(getWorkerCount(), blockCount, [&](std::size_t, std::size_t begin, std::size_t end) {
+		std::array<glm::vec3, colorBlockSize> blockColors;
+		for(std::size_t block = begin; block < end; block++)
+		{
+			std::size_t first = block * colorBlockSize;
+			std::size_t count = std::min(colorBlockSize, colors.size() - first);
+			for(std::size_t point = 0; point < count; point++)
+				blockColors[point] = glm::vec3(colors[first + point]) / 255.0f;
+			BlockFit fit = fitBlock(blockColors.data(), count, indexBits);
+
+			std::uint32_t* data = blocks.data() + block * blockWords;
+			data[0] = fit.endpoints;
+			//indices may straddle two words, the shader reads them the same way
+			for(std::size_t point = 0; point < count; point++)
+			{
+				std::size_t bit = point * indexBits;
+				data[1 + bit / 32] |= fit.indices[point] << bit % 32;
+				if(bit % 32 + indexBits > 32)
+					data[2 + bit / 32] |= fit.indices[point] >> (32 - bit % 32);
+			}
+		}
+	});
+	return blocks;
+}
+
+glm::u8vec3 fromColorBlocks(Span<std::uint32_t const> blocks, std::size_t point, int indexBits)
+{
+	std::uint32_t const* data = blocks.data() + point / colorBlockSize * getColorBlockWords(indexBits);
+	std::size_t bit = point % colorBlockSize * indexBits;
+	std::uint32_t index = data[1 + bit / 32] >> bit % 32;
+	if(bit % 32 + indexBits > 32)
+		index |= data[2 + bit / 32] << (32 - bit % 32);
+	index &= (1u << indexBits) - 1;
+	float t = float(index) / ((1u << indexBits) - 1);
+	return toByte(glm::mix(fromRGB565(data[0] & 0xFFFF), fromRGB565(data[0] >> 16), t));
+}
+
+float getColorPSNR(Span<glm::u8vec3 const> colors, Span<std::uint32_t const> blocks, int indexBits)
+{
+	std::size_t workerCount = getWorkerCount();
+	std::vector<double> squaredErrors(workerCount, 0.0);
+	parallelFor(workerCount, colors.size(), [&](std::size_t worker, std::size_t begin, std::size_t end) {
+		double sum = 0.0;
+		for(std::size_t point = begin; point < end; point++)
+		{
+			glm::ivec3 difference = glm::ivec3(fromColorBlocks(blocks, point, indexBits)) - glm::ivec3(colors[point]);
+			sum += difference.r * difference.r + difference.g * difference.g + difference.b * difference.b;
+		}
+		squaredErrors[worker] += sum;
+	});
+
+	double meanSquaredError = 0.0;
+	for(double error : squaredErrors)
+		meanSquaredError += error;
+	meanSquaredError /= 3.0 * std::max<std::size_t>(colors.size(), 1);
+	if(meanSquaredError == 0.0)
+		return std::numeric_limits<float>::infinity();
+	return float(10.0 * std::log10(255.0 * 255.0 / meanSquaredError));
+}
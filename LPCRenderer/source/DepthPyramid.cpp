@@ -0,0 +1,101 @@
+#include "DepthPyramid.h"
+#include "OSWindow.h"
+#include "Shader.h"
+#include "glad/glad.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	Shader reduceShader{"shaders/pcDepthPyramid.comp"};
+}
+
+DepthPyramid::DepthPyramid(DepthPyramid&& other)
+	:depthTexture(other.depthTexture), pyramidTexture(other.pyramidTexture), size(other.size), levelCount(other.levelCount)
+{
+	other.depthTexture = 0;
+	other.pyramidTexture = 0;
+	other.size = glm::ivec2{0};
+	other.levelCount = 0;
+}
+
+DepthPyramid::~DepthPyramid()
+{
+	free();
+}
+
+DepthPyramid& DepthPyramid::operator=(DepthPyramid&& other)
+{
+	free();
+	depthTexture = other.depthTexture;
+	pyramidTexture = other.pyramidTexture;
+	size = other.size;
+	levelCount = other.levelCount;
+	other.depthTexture = 0;
+	other.pyramidTexture = 0;
+	other.size = glm::ivec2{0};
+	other.levelCount = 0;
+	return *this;
+}
+
+void DepthPyramid::free()
+{
+	glDeleteTextures(1, &depthTexture);
+	glDeleteTextures(1, &pyramidTexture);
+	depthTexture = 0;
+	pyramidTexture = 0;
+	size = glm::ivec2{0};
+	levelCount = 0;
+}
+
+void DepthPyramid::allocate(glm::ivec2 size)
+{
+	free();
+	this->size = size;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &depthTexture);
+	glTextureStorage2D(depthTexture, 1, GL_DEPTH_COMPONENT32F, size.x, size.y);
+	glTextureParameteri(depthTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(depthTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glm::ivec2 pyramidSize = glm::max(size / 2, glm::ivec2{1});
+	levelCount = int(std::log2(std::max(pyramidSize.x, pyramidSize.y))) + 1;
+	glCreateTextures(GL_TEXTURE_2D, 1, &pyramidTexture);
+	glTextureStorage2D(pyramidTexture, levelCount, GL_R32F, pyramidSize.x, pyramidSize.y);
+	glTextureParameteri(pyramidTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(pyramidTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+void DepthPyramid::build()
+{
+	if(OSWindow::getSize() != size)
+		allocate(OSWindow::getSize());
+	glCopyTextureSubImage2D(depthTexture, 0, 0, 0, 0, 0, size.x, size.y);
+
+	reduceShader.use();
+	reduceShader.set("source", 0);
+	unsigned int source = depthTexture;
+	int sourceLevel = 0;
+	for(int level = 0; level < levelCount; level++)
+	{
+		glm::ivec2 levelSize = glm::max(size / (2 << level), glm::ivec2{1});
+		glBindTextureUnit(0, source);
+		reduceShader.set("sourceLevel", sourceLevel);
+		glBindImageTexture(0, pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((levelSize.x + 7) / 8, (levelSize.y + 7) / 8, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		source = pyramidTexture;
+		sourceLevel = level;
+	}
+}
+
+void DepthPyramid::bind(unsigned int unit) const
+{
+	glBindTextureUnit(unit, pyramidTexture);
+}
+
+int DepthPyramid::getLevelCount() const
+{
+	return levelCount;
+}
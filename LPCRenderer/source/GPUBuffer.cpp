@@ -2,6 +2,8 @@
 #include "Profiler.h"
 #include "imgui.h"
 
+#include <cstring>
+
 GPUBuffer::GPUBuffer(GLenum target)
 	:target(target)
 {
@@ -9,10 +11,14 @@ GPUBuffer::GPUBuffer(GLenum target)
 
 GPUBuffer::GPUBuffer(GPUBuffer&& other)
 	:ID(other.ID), target(other.target), 
-	currentSize(other.currentSize)
+	currentSize(other.currentSize), mapping(other.mapping),
+	regionSize(other.regionSize), fences(std::move(other.fences)),
+	currentRegion(other.currentRegion), head(other.head)
 {
 	other.ID = 0;
 	other.currentSize = 0;
+	other.mapping = nullptr;
+	other.fences.clear();
 }
 
 GPUBuffer& GPUBuffer::operator=(GPUBuffer&& other)
@@ -21,8 +27,15 @@ GPUBuffer& GPUBuffer::operator=(GPUBuffer&& other)
 	ID = other.ID;
 	target = other.target;
 	currentSize = other.currentSize;
+	mapping = other.mapping;
+	regionSize = other.regionSize;
+	fences = std::move(other.fences);
+	currentRegion = other.currentRegion;
+	head = other.head;
 	other.ID = 0;
 	other.currentSize = 0;
+	other.mapping = nullptr;
+	other.fences.clear();
 	return *this;
 }
 
@@ -46,6 +59,11 @@ void GPUBuffer::free()
 		currentSize = 0;
 		glBindBuffer(target, 0);
 	}
+	//deleting the buffer unmaps it
+	mapping = nullptr;
+	for(auto fence : fences)
+		glDeleteSync(fence);
+	fences.clear();
 }
 
 void GPUBuffer::clear()
@@ -65,21 +83,30 @@ void GPUBuffer::write(std::vector<std::pair<std::byte const*, std::size_t>>&& da
 	Profiler::recordGPUAllocation(newSize);
 	currentSize = newSize;
 
-	std::vector<std::byte> joinedData;
-	joinedData.resize(newSize);
+	glGenBuffers(1, &ID);
+	bind();
+	//a single range, e.g. a cached packed stream, is handed to the driver as is
+	if(data.size() == 1)
+	{
+		glBufferStorage(target, newSize, data.front().first, 0);
+		return;
+	}
+
+	//several ranges are copied straight into the mapped storage instead of being joined on the host first
+	glBufferStorage(target, newSize, nullptr, GL_MAP_WRITE_BIT);
+	if(newSize == 0)
+		return;
+	auto destination = static_cast<std::byte*>(glMapBufferRange(target, 0, newSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
 	std::size_t offset = 0;
 	for(auto const& buffer : data)
 	{
-		std::memcpy(joinedData.data() + offset, buffer.first, buffer.second);
+		std::memcpy(destination + offset, buffer.first, buffer.second);
 		offset += buffer.second;
 	}
-
-	glGenBuffers(1, &ID);
-	bind();
-	glBufferStorage(target, joinedData.size(), joinedData.data(), 0);
+	glUnmapBuffer(target);
 }
 
-void GPUBuffer::reserve(std::size_t size)
+void GPUBuffer::reserve(std::size_t size, GLbitfield flags)
 {
 	free();
 	Profiler::recordGPUAllocation(size);
@@ -87,7 +114,88 @@ void GPUBuffer::reserve(std::size_t size)
 
 	glGenBuffers(1, &ID);
 	bind();
-	glBufferStorage(target, size, nullptr, 0);
+	glBufferStorage(target, size, nullptr, flags);
+}
+
+//only valid on buffers reserved with GL_DYNAMIC_STORAGE_BIT
+void GPUBuffer::update(std::size_t offset, std::byte const* data, std::size_t size)
+{
+	if(offset + size > currentSize)
+		throw "Buffer update out of range!";
+	bind();
+	glBufferSubData(target, offset, size, data);
+}
+
+//waits for every pending write to the buffer
+void GPUBuffer::read(std::size_t offset, std::byte* data, std::size_t size) const
+{
+	if(offset + size > currentSize)
+		throw "Buffer read out of range!";
+	bind();
+	glGetBufferSubData(target, offset, size, data);
+}
+
+void GPUBuffer::copy(GPUBuffer const& source, std::size_t sourceOffset, std::size_t offset, std::size_t size)
+{
+	if(sourceOffset + size > source.currentSize || offset + size > currentSize)
+		throw "Buffer copy out of range!";
+	source.bind(GL_COPY_READ_BUFFER);
+	bind(GL_COPY_WRITE_BUFFER);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, offset, size);
+}
+
+void GPUBuffer::reserveStreaming(std::size_t regionSize, std::size_t regionCount, GLbitfield access)
+{
+	GLbitfield flags = access | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	reserve(regionSize * regionCount, flags);
+	mapping = static_cast<std::byte*>(glMapBufferRange(target, 0, currentSize, flags));
+	this->regionSize = regionSize;
+	fences.assign(regionCount, nullptr);
+	currentRegion = 0;
+	head = 0;
+}
+
+void GPUBuffer::advanceRegion()
+{
+	if(fences.empty())
+		throw "Buffer is not streaming!";
+	fences[currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	currentRegion = (currentRegion + 1) % fences.size();
+	head = 0;
+	if(!fences[currentRegion])
+		return;
+
+	Profiler::beginFenceWait();
+	GLenum status = glClientWaitSync(fences[currentRegion], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while(status == GL_TIMEOUT_EXPIRED)
+		status = glClientWaitSync(fences[currentRegion], 0, 1000000);
+	Profiler::endFenceWait();
+	glDeleteSync(fences[currentRegion]);
+	fences[currentRegion] = nullptr;
+}
+
+std::optional<std::size_t> GPUBuffer::allocate(std::size_t size, std::size_t alignment)
+{
+	std::size_t begin = (head + alignment - 1) / alignment * alignment;
+	if(begin + size > regionSize)
+		return std::nullopt;
+	head = begin + size;
+	return currentRegion * regionSize + begin;
+}
+
+std::byte* GPUBuffer::map(std::size_t offset) const
+{
+	if(!mapping || offset > currentSize)
+		throw "Buffer is not mapped!";
+	return mapping + offset;
+}
+
+//coherent, so the data is visible to every command issued afterwards
+void GPUBuffer::writeMapped(std::size_t offset, std::byte const* data, std::size_t size)
+{
+	if(offset + size > currentSize)
+		throw "Buffer write out of range!";
+	std::memcpy(map(offset), data, size);
 }
 
 void GPUBuffer::bind() const
@@ -101,6 +209,11 @@ void GPUBuffer::bind(GLenum target) const
 }
 
 void GPUBuffer::bindBase(unsigned int base) const
+{
+	bindBase(target, base);
+}
+
+void GPUBuffer::bindBase(GLenum target, unsigned int base) const
 {
 	if (target != GL_SHADER_STORAGE_BUFFER && target != GL_ATOMIC_COUNTER_BUFFER)
 		throw "Illegal bindbufferbase!";
@@ -136,3 +249,13 @@ void drawMemoryConsumption(std::size_t amountInBytes)
 		ImGui::Text("%lu B ", amountInBytes);
 	}
 }
+
+std::size_t getMaxShaderStorageBlockSize()
+{
+	static std::size_t const maxSize = []() {
+		GLint64 size = 0;
+		glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &size);
+		return static_cast<std::size_t>(size);
+	}();
+	return maxSize;
+}
@@ -1,109 +1,441 @@
 #include "Importer.h"
+#include "BrickCache.h"
 #include "SceneManager.h"
 #include "PCManager.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Span.h"
+#include "ThreadPool.h"
 #include "glm/gtc/quaternion.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #define TINYPLY_IMPLEMENTATION
 #include "tinyply.h"
+#include "imgui.h"
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 
-struct MeshData
+enum class PLYFormat
 {
-	std::vector<glm::vec3> positions;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::u8vec3> colors;
+	ascii,
+	binaryLittleEndian,
+	binaryBigEndian
 };
 
+enum class PLYType
+{
+	invalid,
+	int8,
+	uint8,
+	int16,
+	uint16,
+	int32,
+	uint32,
+	float32,
+	float64
+};
+
+struct PLYProperty
+{
+	PLYType type = PLYType::invalid;
+	std::size_t offset = 0;
+};
+
+//layout of the vertex element of a ply file, so vertices can be decoded straight out of the file mapping
+struct PLYVertices
+{
+	std::filesystem::path filename;
+	MappedFile file;
+	PLYFormat format = PLYFormat::ascii;
+	//binary, with only fixed size elements in front of the vertices
+	bool directlyReadable = false;
+	std::size_t count = 0;
+	std::size_t start = 0;
+	std::size_t stride = 0;
+	std::array<PLYProperty, 3> positions;
+	std::optional<std::array<PLYProperty, 3>> normals;
+	std::optional<std::array<PLYProperty, 3>> colors;
+	std::optional<glm::mat4> transform;
+};
+
+struct PLYScan
+{
+	std::filesystem::path filename;
+	std::optional<glm::mat4> transform;
+};
+
+enum class ImportStage
+{
+	queued,
+	opening,
+	decoding,
+	building,
+	finished
+};
+
+//one drop of files, loaded on the import thread and handed to the managers by Importer::update
+struct ImportJob
+{
+	std::vector<std::filesystem::path> filenames;
+	std::string name;
+	std::atomic<ImportStage> stage{ImportStage::queued};
+	std::atomic<bool> cancelled{false};
+	std::atomic<std::size_t> scansOpened{0};
+	std::atomic<std::size_t> scansTotal{0};
+	std::atomic<std::size_t> verticesDecoded{0};
+	std::atomic<std::size_t> verticesTotal{0};
+	std::unique_ptr<PointCloud> cloud;
+	std::unique_ptr<PointCloud> decimatedCloud;
+	//why loading failed, written before the job is marked finished
+	std::string error;
+};
+
+namespace Importer
+{
+	static void work();
+}
+
+namespace
+{
+	//vertices decoded by one task, large enough to amortize scheduling and small enough to balance across scans
+	constexpr std::size_t decodeChunkSize = 1 << 20;
+
+	//declaration order matters, the import thread has to be joined before the pool and the queue are destroyed
+	ThreadPool pool{getWorkerCount()};
+	std::mutex jobsMutex;
+	std::condition_variable jobsAvailable;
+	std::vector<std::shared_ptr<ImportJob>> jobs;
+	bool stopping = false;
+	//shown in the import window until dismissed, only touched by the main thread
+	std::vector<std::shared_ptr<ImportJob>> failedJobs;
+
+	class ImportThread
+	{
+	private:
+		std::thread thread;
+
+	public:
+		void start()
+		{
+			if(!thread.joinable())
+				thread = std::thread{Importer::work};
+		}
+
+		~ImportThread()
+		{
+			{
+				std::lock_guard lock{jobsMutex};
+				stopping = true;
+				for(auto& job : jobs)
+					job->cancelled = true;
+			}
+			jobsAvailable.notify_all();
+			if(thread.joinable())
+				thread.join();
+		}
+	} importThread;
+}
+
 namespace Importer
 {
-	static std::vector<MeshData> importCONF(std::filesystem::path const& filename);
-	static MeshData importPLY(std::filesystem::path const& filename);
+	static void load(ImportJob& job);
+	static std::vector<PLYScan> parseCONF(std::filesystem::path const& filename);
+	static PLYVertices openPLY(std::filesystem::path const& filename);
+	static void decodePLY(PLYVertices const& source, std::size_t begin, std::size_t end, Span<glm::vec3> positions, Span<glm::vec3> normals, Span<glm::u8vec3> colors);
+	static void decodePLYWithTinyply(PLYVertices const& source, Span<glm::vec3> positions, Span<glm::vec3> normals, Span<glm::u8vec3> colors);
+	static void transformPositions(Span<glm::vec3> positions, glm::mat4 const& transform);
+
+	//every task is waited for before the first failure is rethrown, they all reference the caller's locals
+	static void waitForAll(std::vector<std::future<void>>& tasks)
+	{
+		std::exception_ptr exception;
+		for(auto& task : tasks)
+		{
+			try
+			{
+				task.get();
+			}
+			catch(...)
+			{
+				if(!exception)
+					exception = std::current_exception();
+			}
+		}
+		tasks.clear();
+		if(exception)
+			std::rethrow_exception(exception);
+	}
+
+	static void enqueue(std::vector<std::filesystem::path> filenames)
+	{
+		auto job = std::make_shared<ImportJob>();
+		job->name = filenames.front().filename().string();
+		job->filenames = std::move(filenames);
+		{
+			std::lock_guard lock{jobsMutex};
+			jobs.push_back(std::move(job));
+		}
+		importThread.start();
+		jobsAvailable.notify_one();
+	}
 
 	void import(std::vector<std::filesystem::path> const& filenames)
 	{
-		std::vector<MeshData> meshes;
-		std::string name = filenames.front().filename().string();
+		//brick caches are complete clouds on their own, everything else is merged into one cloud
+		std::vector<std::filesystem::path> scanFilenames;
 		for(auto& filename : filenames)
+		{
+			if(filename.extension().string() == BrickCache::extension)
+				enqueue({filename});
+			else
+				scanFilenames.push_back(filename);
+		}
+		if(!scanFilenames.empty())
+			enqueue(std::move(scanFilenames));
+	}
+
+	void update()
+	{
+		std::vector<std::shared_ptr<ImportJob>> finishedJobs;
+		{
+			std::lock_guard lock{jobsMutex};
+			auto firstFinished = std::stable_partition(jobs.begin(), jobs.end(), [](auto const& job) {
+				return job->stage != ImportStage::finished;
+			});
+			finishedJobs.assign(std::make_move_iterator(firstFinished), std::make_move_iterator(jobs.end()));
+			jobs.erase(firstFinished, jobs.end());
+		}
+
+		for(auto& job : finishedJobs)
+		{
+			if(!job->error.empty())
+				failedJobs.push_back(job);
+			if(job->cancelled || !job->cloud)
+				continue;
+			auto cloud = PCManager::add(std::move(job->cloud));
+			SceneManager::add(std::make_unique<Scene>(cloud));
+			if(job->decimatedCloud)
+			{
+				auto decimatedCloud = PCManager::add(std::move(job->decimatedCloud));
+				decimatedCloud->setName(cloud->getName() + "(decimated)");
+				SceneManager::add(std::make_unique<Scene>(decimatedCloud));
+			}
+		}
+	}
+
+	void drawUI()
+	{
+		int id = 0;
+		for(auto job = failedJobs.begin(); job != failedJobs.end();)
+		{
+			ImGui::PushID(id++);
+			ImGui::Separator();
+			ImGui::Text("%s", (*job)->name.data());
+			ImGui::TextWrapped("Failed: %s", (*job)->error.data());
+			bool dismissed = ImGui::Button("Dismiss");
+			ImGui::PopID();
+			job = dismissed ? failedJobs.erase(job) : job + 1;
+		}
+
+		std::lock_guard lock{jobsMutex};
+		if(jobs.empty())
+		{
+			if(failedJobs.empty())
+				ImGui::Text("No import running");
+			return;
+		}
+		for(auto& job : jobs)
+		{
+			ImGui::PushID(id++);
+			ImGui::Separator();
+			ImGui::Text("%s", job->name.data());
+			ImportStage stage = job->stage;
+			if(job->cancelled)
+				ImGui::Text("Cancelling");
+			else if(stage == ImportStage::queued)
+				ImGui::Text("Queued");
+			else if(stage == ImportStage::building)
+				ImGui::Text("Building point cloud");
+			else if(stage != ImportStage::finished)
+			{
+				std::size_t scansOpened = job->scansOpened;
+				std::size_t scansTotal = job->scansTotal;
+				std::size_t verticesDecoded = job->verticesDecoded;
+				std::size_t verticesTotal = job->verticesTotal;
+				ImGui::Text("Scans opened: %zu / %zu", scansOpened, scansTotal);
+				ImGui::ProgressBar(scansTotal == 0 ? 0.0f : static_cast<float>(scansOpened) / scansTotal);
+				ImGui::Text("Vertices decoded: %zu / %zu", verticesDecoded, verticesTotal);
+				ImGui::ProgressBar(verticesTotal == 0 ? 0.0f : static_cast<float>(verticesDecoded) / verticesTotal);
+			}
+			if(stage != ImportStage::finished && !job->cancelled && ImGui::Button("Cancel"))
+				job->cancelled = true;
+			ImGui::PopID();
+		}
+	}
+
+	void work()
+	{
+		while(true)
+		{
+			std::shared_ptr<ImportJob> job;
+			{
+				std::unique_lock lock{jobsMutex};
+				auto next = [&]() {
+					return std::find_if(jobs.begin(), jobs.end(), [](auto const& job) {
+						return job->stage == ImportStage::queued;
+					});
+				};
+				jobsAvailable.wait(lock, [&]() {
+					return stopping || next() != jobs.end();
+				});
+				if(stopping)
+					return;
+				job = *next();
+				job->stage = ImportStage::opening;
+			}
+			//a broken file only fails its own job
+			try
+			{
+				if(!job->cancelled)
+					load(*job);
+			}
+			catch(std::exception const& exception)
+			{
+				job->error = exception.what();
+				std::cerr << job->error + "\n";
+			}
+			job->stage = ImportStage::finished;
+		}
+	}
+
+	void load(ImportJob& job)
+	{
+		if(job.filenames.front().extension().string() == BrickCache::extension)
+		{
+			job.cloud = BrickCache::load(job.filenames.front());
+			//the cache reports the reason on the console
+			if(!job.cloud)
+				throw std::runtime_error("Failed to load the brick cache " + job.filenames.front().string());
+			return;
+		}
+
+		std::vector<PLYScan> scans;
+		for(auto& filename : job.filenames)
 		{
 			if(filename.extension().string() == ".ply")
 			{
-				meshes.push_back(importPLY(filename));
+				scans.push_back(PLYScan{filename, std::nullopt});
 			}
 			else if(filename.extension().string() == ".conf")
 			{
-				auto m = importCONF(filename);
-				meshes.insert(meshes.end(),
-					std::make_move_iterator(m.begin()),
-					std::make_move_iterator(m.end())
-				);
+				auto s = parseCONF(filename);
+				scans.insert(scans.end(), s.begin(), s.end());
 			}
 		}
+		if(scans.empty())
+			return;
+		job.scansTotal = scans.size();
+
+		//headers are parsed and files mapped concurrently, conf datasets often reference hundreds of scans
+		std::vector<PLYVertices> sources(scans.size());
+		std::vector<std::future<void>> tasks;
+		for(std::size_t i = 0; i < scans.size(); i++)
+		{
+			tasks.push_back(pool.submit([&, i]() {
+				if(job.cancelled)
+					return;
+				sources[i] = openPLY(scans[i].filename);
+				sources[i].transform = scans[i].transform;
+				job.scansOpened++;
+			}));
+		}
+		waitForAll(tasks);
+		if(job.cancelled)
+			return;
 
 		std::size_t verticesCount = 0;
-		for (auto const& mesh : meshes)
-			verticesCount += mesh.positions.size();
-		std::vector<glm::vec3> allPositions;
-		allPositions.reserve(verticesCount);
-		
 		bool useNormals = true;
 		bool useColors = true;
-
-		for (auto& mesh : meshes)
+		for(auto const& source : sources)
 		{
-			allPositions.insert(allPositions.end(),
-				std::make_move_iterator(mesh.positions.begin()),
-				std::make_move_iterator(mesh.positions.end())
-			);
-			useNormals = useNormals && !mesh.normals.empty();
-			useColors = useColors && !mesh.colors.empty();
+			verticesCount += source.count;
+			useNormals = useNormals && source.normals;
+			useColors = useColors && source.colors;
 		}
-		std::vector<glm::vec3> allNormals;
-		if (useNormals)
+		job.verticesTotal = verticesCount;
+		job.stage = ImportStage::decoding;
+
+		//every file is decoded straight into its slice of the final arrays, chunks of all scans share the pool
+		std::vector<glm::vec3> allPositions(verticesCount);
+		std::vector<glm::vec3> allNormals(useNormals ? verticesCount : 0);
+		std::vector<glm::u8vec3> allColors(useColors ? verticesCount : 0);
+		std::size_t offset = 0;
+		for(auto const& source : sources)
 		{
-			allNormals.reserve(verticesCount);
-			for (auto& mesh : meshes)
+			Span<glm::vec3> positions{allPositions.data() + offset, source.count};
+			Span<glm::vec3> normals;
+			if(useNormals)
+				normals = {allNormals.data() + offset, source.count};
+			Span<glm::u8vec3> colors;
+			if(useColors)
+				colors = {allColors.data() + offset, source.count};
+
+			if(source.directlyReadable)
 			{
-				allNormals.insert(allNormals.end(),
-					std::make_move_iterator(mesh.normals.begin()),
-					std::make_move_iterator(mesh.normals.end())
-				);
+				for(std::size_t begin = 0; begin < source.count; begin += decodeChunkSize)
+				{
+					std::size_t end = std::min(source.count, begin + decodeChunkSize);
+					tasks.push_back(pool.submit([&job, &source, begin, end, positions, normals, colors]() {
+						if(job.cancelled)
+							return;
+						decodePLY(source, begin, end, positions, normals, colors);
+						job.verticesDecoded += end - begin;
+					}));
+				}
 			}
-		}
-
-		std::vector<glm::u8vec3> allColors;
-		if(useColors)
-		{
-			allColors.reserve(verticesCount);
-			for(auto& mesh : meshes)
+			else
 			{
-				allColors.insert(allColors.end(),
-					std::make_move_iterator(mesh.colors.begin()),
-					std::make_move_iterator(mesh.colors.end())
-				);
+				tasks.push_back(pool.submit([&job, &source, positions, normals, colors]() {
+					if(job.cancelled)
+						return;
+					decodePLYWithTinyply(source, positions, normals, colors);
+					if(source.transform)
+						transformPositions(positions, *source.transform);
+					job.verticesDecoded += source.count;
+				}));
 			}
+			offset += source.count;
 		}
+		waitForAll(tasks);
+		sources.clear();
+		if(job.cancelled)
+			return;
 
+		job.stage = ImportStage::building;
 		bool makeDecimated = allPositions.size() > 1'000'000;
-		auto cloud = PCManager::add(std::make_unique<PointCloud>(std::move(allPositions), std::move(allNormals), std::move(allColors)));
-		SceneManager::add(std::make_unique<Scene>(cloud));
-		if(makeDecimated)
-		{
-			auto decimatedCloud = PCManager::add(cloud->decimate(1'000'000));
-			decimatedCloud->setName(cloud->getName() + "(decimated)");
-			SceneManager::add(std::make_unique<Scene>(decimatedCloud));
-		}
+		job.cloud = std::make_unique<PointCloud>(std::move(allPositions), std::move(allNormals), std::move(allColors));
+		if(makeDecimated && !job.cancelled)
+			job.decimatedCloud = job.cloud->decimate(1'000'000);
 	}
 
-	std::vector<MeshData> importCONF(std::filesystem::path const& filename)
+	std::vector<PLYScan> parseCONF(std::filesystem::path const& filename)
 	{
-		std::vector<MeshData> meshes;
+		std::vector<PLYScan> scans;
 		std::ifstream filestream{filename};
 		if(filestream.fail())
 		{
-			std::cerr << "Failed to open" + filename.string();
-			std::terminate();
+			throw std::runtime_error("Failed to open " + filename.string());
 		}
 		std::string token;
 		while(filestream >> token)
@@ -123,64 +455,310 @@ namespace Importer
 				filestream >> rotation.w;
 				glm::mat4 rotationMatrix = glm::transpose(glm::mat4_cast(rotation));
 				glm::mat4 translationMatrix = glm::translate(glm::mat4{1.0f}, translation);
-				meshes.push_back(importPLY(filename.parent_path() / meshName));
-				for (auto& position : meshes.back().positions)
-					position = translationMatrix * rotationMatrix * glm::vec4{ position, 1.0f };
+				scans.push_back(PLYScan{filename.parent_path() / meshName, translationMatrix * rotationMatrix});
 			}
 		}
-		return meshes;
+		return scans;
 	}
 
-	MeshData importPLY(std::filesystem::path const& filename)
+	static std::size_t sizeOf(PLYType type)
 	{
-		std::ifstream fileStream{filename, std::ios::binary};
-		if(fileStream.fail())
+		switch(type)
 		{
-			std::cerr << "Failed to open" + filename.string();
-			std::terminate();
+			case PLYType::int8:
+			case PLYType::uint8:
+				return 1;
+			case PLYType::int16:
+			case PLYType::uint16:
+				return 2;
+			case PLYType::int32:
+			case PLYType::uint32:
+			case PLYType::float32:
+				return 4;
+			case PLYType::float64:
+				return 8;
+			default:
+				return 0;
 		}
+	}
 
-		tinyply::PlyFile file;
-		file.parse_header(fileStream);
-		std::shared_ptr<tinyply::PlyData> plyPositions =
-			file.request_properties_from_element("vertex", {"x", "y", "z"});
-		bool normalsAvailable = true;
-		std::shared_ptr<tinyply::PlyData> plyNormals;
-		try
+	static PLYType parseType(std::string const& type)
+	{
+		if(type == "char" || type == "int8")
+			return PLYType::int8;
+		if(type == "uchar" || type == "uint8")
+			return PLYType::uint8;
+		if(type == "short" || type == "int16")
+			return PLYType::int16;
+		if(type == "ushort" || type == "uint16")
+			return PLYType::uint16;
+		if(type == "int" || type == "int32")
+			return PLYType::int32;
+		if(type == "uint" || type == "uint32")
+			return PLYType::uint32;
+		if(type == "float" || type == "float32")
+			return PLYType::float32;
+		if(type == "double" || type == "float64")
+			return PLYType::float64;
+		return PLYType::invalid;
+	}
+
+	PLYVertices openPLY(std::filesystem::path const& filename)
+	{
+		PLYVertices source;
+		source.filename = filename;
+		source.file = MappedFile{filename};
+		if(!source.file.isOpen())
 		{
-			plyNormals = file.request_properties_from_element("vertex", {"nx", "ny", "nz"});
+			throw std::runtime_error("Failed to open " + filename.string());
 		}
-		catch(...)
+
+		std::string_view contents{reinterpret_cast<char const*>(source.file.data()), source.file.size()};
+		std::size_t headerEnd = contents.find("end_header");
+		if(contents.substr(0, 3) != "ply" || headerEnd == std::string_view::npos)
 		{
-			normalsAvailable = false;
+			throw std::runtime_error("Invalid ply header in " + filename.string());
 		}
+		std::size_t dataStart = contents.find('\n', headerEnd);
+		dataStart = dataStart == std::string_view::npos ? contents.size() : dataStart + 1;
 
-		bool colorsAvailable = true;
-		std::shared_ptr<tinyply::PlyData> plyColors;
-		try
+		std::istringstream header{std::string{contents.substr(0, headerEnd)}};
+		std::string line;
+		std::string currentElement;
+		std::size_t currentElementCount = 0;
+		std::size_t currentElementSize = 0;
+		bool currentElementFixedSize = true;
+		bool vertexElementFound = false;
+		bool fixedSizeBeforeVertices = true;
+		std::size_t bytesBeforeVertices = 0;
+		std::array<std::optional<PLYProperty>, 9> properties;
+		std::array<std::string, 9> const propertyNames = {"x", "y", "z", "nx", "ny", "nz", "red", "green", "blue"};
+
+		auto finishElement = [&]() {
+			if(currentElement == "vertex")
+			{
+				source.stride = currentElementSize;
+				source.directlyReadable = currentElementFixedSize;
+			}
+			else if(!vertexElementFound)
+			{
+				bytesBeforeVertices += currentElementCount * currentElementSize;
+				fixedSizeBeforeVertices = fixedSizeBeforeVertices && currentElementFixedSize;
+			}
+		};
+
+		while(std::getline(header, line))
 		{
-			plyColors = file.request_properties_from_element("vertex", {"red", "green", "blue"});
+			std::istringstream tokens{line};
+			std::string keyword;
+			tokens >> keyword;
+			if(keyword == "format")
+			{
+				std::string format;
+				tokens >> format;
+				if(format == "binary_little_endian")
+					source.format = PLYFormat::binaryLittleEndian;
+				else if(format == "binary_big_endian")
+					source.format = PLYFormat::binaryBigEndian;
+				else
+					source.format = PLYFormat::ascii;
+			}
+			else if(keyword == "element")
+			{
+				finishElement();
+				if(currentElement == "vertex")
+					vertexElementFound = true;
+				tokens >> currentElement >> currentElementCount;
+				currentElementSize = 0;
+				currentElementFixedSize = true;
+				if(currentElement == "vertex")
+					source.count = currentElementCount;
+			}
+			else if(keyword == "property")
+			{
+				std::string type;
+				tokens >> type;
+				if(type == "list")
+				{
+					currentElementFixedSize = false;
+					continue;
+				}
+				std::string propertyName;
+				tokens >> propertyName;
+				PLYType propertyType = parseType(type);
+				if(currentElement == "vertex")
+				{
+					for(std::size_t i = 0; i < propertyNames.size(); i++)
+						if(propertyName == propertyNames[i])
+							properties[i] = PLYProperty{propertyType, currentElementSize};
+				}
+				currentElementSize += sizeOf(propertyType);
+				currentElementFixedSize = currentElementFixedSize && propertyType != PLYType::invalid;
+			}
 		}
-		catch(...)
+		finishElement();
+
+		auto group = [&](int first) -> std::optional<std::array<PLYProperty, 3>> {
+			if(!properties[first] || !properties[first + 1] || !properties[first + 2])
+				return std::nullopt;
+			return std::array<PLYProperty, 3>{*properties[first], *properties[first + 1], *properties[first + 2]};
+		};
+		if(!group(0))
 		{
-			colorsAvailable = false;
+			throw std::runtime_error("No vertex positions in " + filename.string());
 		}
-		file.read(fileStream);
+		source.positions = *group(0);
+		source.normals = group(3);
+		source.colors = group(6);
+		source.start = dataStart + bytesBeforeVertices;
+		source.directlyReadable = source.directlyReadable && fixedSizeBeforeVertices && source.format != PLYFormat::ascii
+			&& source.start + source.count * source.stride <= source.file.size();
+		return source;
+	}
 
-		MeshData mesh;
-		mesh.positions.resize(plyPositions->count);
-		std::memcpy(mesh.positions.data(), plyPositions->buffer.get(), plyPositions->buffer.size_bytes());
-		if(normalsAvailable)
+	template<typename T>
+	static T load(std::byte const* data, bool swapBytes)
+	{
+		std::array<std::byte, sizeof(T)> bytes;
+		std::memcpy(bytes.data(), data, sizeof(T));
+		if(swapBytes)
+			std::reverse(bytes.begin(), bytes.end());
+		T value;
+		std::memcpy(&value, bytes.data(), sizeof(T));
+		return value;
+	}
+
+	static double readScalar(std::byte const* vertex, PLYProperty property, bool swapBytes)
+	{
+		std::byte const* data = vertex + property.offset;
+		switch(property.type)
+		{
+			case PLYType::int8:
+				return load<std::int8_t>(data, swapBytes);
+			case PLYType::uint8:
+				return load<std::uint8_t>(data, swapBytes);
+			case PLYType::int16:
+				return load<std::int16_t>(data, swapBytes);
+			case PLYType::uint16:
+				return load<std::uint16_t>(data, swapBytes);
+			case PLYType::int32:
+				return load<std::int32_t>(data, swapBytes);
+			case PLYType::uint32:
+				return load<std::uint32_t>(data, swapBytes);
+			case PLYType::float32:
+				return load<float>(data, swapBytes);
+			case PLYType::float64:
+				return load<double>(data, swapBytes);
+			default:
+				return 0.0;
+		}
+	}
+
+	static glm::vec3 readVector(std::byte const* vertex, std::array<PLYProperty, 3> const& properties, bool swapBytes)
+	{
+		return {
+			readScalar(vertex, properties[0], swapBytes),
+			readScalar(vertex, properties[1], swapBytes),
+			readScalar(vertex, properties[2], swapBytes)
+		};
+	}
+
+	static glm::u8vec3 readColor(std::byte const* vertex, std::array<PLYProperty, 3> const& properties, bool swapBytes)
+	{
+		glm::u8vec3 color;
+		for(int i = 0; i < 3; i++)
+		{
+			double channel = readScalar(vertex, properties[i], swapBytes);
+			if(properties[i].type == PLYType::float32 || properties[i].type == PLYType::float64)
+				channel *= 255.0;
+			color[i] = static_cast<std::uint8_t>(glm::clamp(channel, 0.0, 255.0));
+		}
+		return color;
+	}
+
+	void decodePLY(PLYVertices const& source, std::size_t begin, std::size_t end, Span<glm::vec3> positions, Span<glm::vec3> normals, Span<glm::u8vec3> colors)
+	{
+		std::uint16_t const endiannessProbe = 1;
+		bool hostIsBigEndian = *reinterpret_cast<std::uint8_t const*>(&endiannessProbe) == 0;
+		bool swapBytes = (source.format == PLYFormat::binaryBigEndian) != hostIsBigEndian;
+		std::byte const* vertices = source.file.data() + source.start;
+
+		for(std::size_t i = begin; i < end; i++)
+		{
+			std::byte const* vertex = vertices + i * source.stride;
+			positions[i] = readVector(vertex, source.positions, swapBytes);
+			if(!normals.empty())
+				normals[i] = readVector(vertex, *source.normals, swapBytes);
+			if(!colors.empty())
+				colors[i] = readColor(vertex, *source.colors, swapBytes);
+		}
+
+		//transformed while the chunk is still in cache
+		if(source.transform)
+			transformPositions(positions.subspan(begin, end - begin), *source.transform);
+	}
+
+	//same result as transform * vec4{position, 1}, but points are deinterleaved into tiles
+	//so the compiler can vectorize the arithmetic across points instead of within one
+	void transformPositions(Span<glm::vec3> positions, glm::mat4 const& transform)
+	{
+		constexpr std::size_t tileSize = 256;
+		float const m00 = transform[0][0], m01 = transform[0][1], m02 = transform[0][2];
+		float const m10 = transform[1][0], m11 = transform[1][1], m12 = transform[1][2];
+		float const m20 = transform[2][0], m21 = transform[2][1], m22 = transform[2][2];
+		float const m30 = transform[3][0], m31 = transform[3][1], m32 = transform[3][2];
+		alignas(32) float x[tileSize];
+		alignas(32) float y[tileSize];
+		alignas(32) float z[tileSize];
+
+		for(std::size_t first = 0; first < positions.size(); first += tileSize)
 		{
-			mesh.normals.resize(plyNormals->count);
-			std::memcpy(mesh.normals.data(), plyNormals->buffer.get(), plyNormals->buffer.size_bytes());
+			std::size_t count = std::min(tileSize, positions.size() - first);
+			glm::vec3* tile = positions.data() + first;
+			for(std::size_t i = 0; i < count; i++)
+			{
+				x[i] = tile[i].x;
+				y[i] = tile[i].y;
+				z[i] = tile[i].z;
+			}
+			//evaluated in the same order as glm's mat4 * vec4 so results stay bit identical
+			for(std::size_t i = 0; i < count; i++)
+			{
+				float px = x[i], py = y[i], pz = z[i];
+				x[i] = (m00 * px + m10 * py) + (m20 * pz + m30);
+				y[i] = (m01 * px + m11 * py) + (m21 * pz + m31);
+				z[i] = (m02 * px + m12 * py) + (m22 * pz + m32);
+			}
+			for(std::size_t i = 0; i < count; i++)
+				tile[i] = {x[i], y[i], z[i]};
 		}
-		if(colorsAvailable)
+	}
+
+	void decodePLYWithTinyply(PLYVertices const& source, Span<glm::vec3> positions, Span<glm::vec3> normals, Span<glm::u8vec3> colors)
+	{
+		std::ifstream fileStream{source.filename, std::ios::binary};
+		if(fileStream.fail())
 		{
-			mesh.colors.resize(plyColors->count);
-			std::memcpy(mesh.colors.data(), plyColors->buffer.get(), plyColors->buffer.size_bytes());
+			throw std::runtime_error("Failed to open " + source.filename.string());
 		}
-		return mesh;
+
+		tinyply::PlyFile file;
+		file.parse_header(fileStream);
+		std::shared_ptr<tinyply::PlyData> plyPositions =
+			file.request_properties_from_element("vertex", {"x", "y", "z"});
+		std::shared_ptr<tinyply::PlyData> plyNormals;
+		if(!normals.empty())
+			plyNormals = file.request_properties_from_element("vertex", {"nx", "ny", "nz"});
+		std::shared_ptr<tinyply::PlyData> plyColors;
+		if(!colors.empty())
+			plyColors = file.request_properties_from_element("vertex", {"red", "green", "blue"});
+		file.read(fileStream);
+
+		std::memcpy(positions.data(), plyPositions->buffer.get(), std::min(plyPositions->buffer.size_bytes(), positions.sizeInBytes()));
+		if(plyNormals)
+			std::memcpy(normals.data(), plyNormals->buffer.get(), std::min(plyNormals->buffer.size_bytes(), normals.sizeInBytes()));
+		if(plyColors)
+			std::memcpy(colors.data(), plyColors->buffer.get(), std::min(plyColors->buffer.size_bytes(), colors.sizeInBytes()));
 	}
 
 }
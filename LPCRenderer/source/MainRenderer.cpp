@@ -10,7 +10,11 @@
 #include "PCRendererUncompressed.h"
 #include "PCRendererBrickGS.h"
 #include "PCRendererBrickIndirect.h"
+#include "PCRendererBrickExpansion.h"
 #include "PCRendererBitmap.h"
+#include "PCRendererOctree.h"
+#include "PCRendererDelta.h"
+#include "PCRendererRasterizer.h"
 
 #include <array>
 
@@ -25,8 +29,12 @@ enum class CompressionMode
 {
 	none,
 	brickGS,
+	brickExpansion,
 	brickIndirect,
-	bitmap
+	bitmap,
+	octree,
+	delta,
+	rasterizer
 };
 
 namespace
@@ -51,6 +59,8 @@ void MainRenderer::render(Scene* scene)
 
 	if(!scene->getPointCloud())
 		return;
+	//views of the streams evicted last frame are gone by now
+	scene->getPointCloud()->releaseRetiredPackedStreams();
 
 	static glm::ivec3 previousSubdivions = scene->getPointCloud()->getSubdivisions();
 	if(previousSubdivions != scene->getPointCloud()->getSubdivisions())
@@ -112,6 +122,12 @@ void MainRenderer::drawUI()
 		compressionMode = CompressionMode::brickGS;
 		pointCloudRenderer = std::make_unique<PCRendererBrickGS>();
 	}
+	ImGui::SameLine();
+	if(ImGui::RadioButton("Brick Compute Expansion", compressionMode == CompressionMode::brickExpansion))
+	{
+		compressionMode = CompressionMode::brickExpansion;
+		pointCloudRenderer = std::make_unique<PCRendererBrickExpansion>();
+	}
 	if(ImGui::RadioButton("Brick Indirect Draw", compressionMode == CompressionMode::brickIndirect))
 	{
 		compressionMode = CompressionMode::brickIndirect;
@@ -123,6 +139,22 @@ void MainRenderer::drawUI()
 		compressionMode = CompressionMode::bitmap;
 		pointCloudRenderer = std::make_unique<PCRendererBitmap>();
 	}
+	if(ImGui::RadioButton("Octree LOD", compressionMode == CompressionMode::octree))
+	{
+		compressionMode = CompressionMode::octree;
+		pointCloudRenderer = std::make_unique<PCRendererOctree>();
+	}
+	ImGui::SameLine();
+	if(ImGui::RadioButton("Delta Coded", compressionMode == CompressionMode::delta))
+	{
+		compressionMode = CompressionMode::delta;
+		pointCloudRenderer = std::make_unique<PCRendererDelta>();
+	}
+	if(ImGui::RadioButton("Compute Rasterizer", compressionMode == CompressionMode::rasterizer))
+	{
+		compressionMode = CompressionMode::rasterizer;
+		pointCloudRenderer = std::make_unique<PCRendererRasterizer>();
+	}
 
 	ImGui::Separator();
 
@@ -0,0 +1,135 @@
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN 1
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX 1
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(std::filesystem::path const& filename)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return;
+	fileHandle = file;
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		unmap();
+		return;
+	}
+	mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(!mappingHandle)
+	{
+		unmap();
+		return;
+	}
+	first = static_cast<std::byte const*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if(!first)
+	{
+		unmap();
+		return;
+	}
+	length = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+	int file = open(filename.c_str(), O_RDONLY);
+	if(file == -1)
+		return;
+	struct stat fileStatus;
+	if(fstat(file, &fileStatus) == 0 && fileStatus.st_size > 0)
+	{
+		void* mapping = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if(mapping != MAP_FAILED)
+		{
+			first = static_cast<std::byte const*>(mapping);
+			length = static_cast<std::size_t>(fileStatus.st_size);
+		}
+	}
+	close(file);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+{
+	*this = std::move(other);
+}
+
+MappedFile::~MappedFile()
+{
+	unmap();
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+	unmap();
+	std::swap(first, other.first);
+	std::swap(length, other.length);
+#ifdef _WIN32
+	std::swap(fileHandle, other.fileHandle);
+	std::swap(mappingHandle, other.mappingHandle);
+#endif
+	return *this;
+}
+
+void MappedFile::unmap()
+{
+#ifdef _WIN32
+	if(first)
+		UnmapViewOfFile(first);
+	if(mappingHandle)
+		CloseHandle(mappingHandle);
+	if(fileHandle)
+		CloseHandle(fileHandle);
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#else
+	if(first)
+		munmap(const_cast<std::byte*>(first), length);
+#endif
+	first = nullptr;
+	length = 0;
+}
+
+bool MappedFile::isOpen() const
+{
+	return first != nullptr;
+}
+
+std::byte const* MappedFile::data() const
+{
+	return first;
+}
+
+std::size_t MappedFile::size() const
+{
+	return length;
+}
+
+//drops the pages of a range from the working set, they are read from the file again on the next access
+void MappedFile::release(void const* range, std::size_t rangeSize) const
+{
+	if(rangeSize == 0)
+		return;
+#ifdef _WIN32
+	//unlocking pages that were never locked removes them from the working set
+	VirtualUnlock(const_cast<void*>(range), rangeSize);
+#else
+	std::uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+	std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(range) / pageSize * pageSize;
+	std::uintptr_t end = reinterpret_cast<std::uintptr_t>(range) + rangeSize;
+	madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+#endif
+}
@@ -0,0 +1,46 @@
+#include "NormalEncoding.h"
+#include "glm/gtc/constants.hpp"
+#include "glm/gtc/packing.hpp"
+
+glm::vec2 toSpherical(glm::vec3 n)
+{
+	float thetaNormalized = glm::acos(n.y) / glm::pi<float>();
+	float phiNormalized = (glm::atan(n.x, n.z) / glm::pi<float>()) * 0.5 + 0.5;
+	return glm::vec2(phiNormalized, thetaNormalized);
+}
+
+std::uint32_t toSpherical16(glm::vec3 n)
+{
+	return glm::packUnorm2x16(toSpherical(n));
+}
+
+std::uint16_t toSpherical8(glm::vec3 n)
+{
+	glm::vec2 s = toSpherical(n);
+	std::uint16_t packed = 256 * s.x;
+	packed |= std::uint16_t(256 * s.y) << 8;
+	return packed;
+}
+
+//same as the lit vertex shaders
+glm::vec3 fromSpherical(std::uint32_t packed, int bits)
+{
+	std::uint32_t mask = (1u << bits) - 1;
+	glm::vec2 s{float(packed & mask) / (1u << bits), float(packed >> bits & mask) / (1u << bits)};
+	float theta = s.y * glm::pi<float>();
+	float phi = s.x * 2.0f * glm::pi<float>() - glm::pi<float>();
+	float sinTheta = std::sin(theta);
+	return {sinTheta * std::sin(phi), std::cos(theta), sinTheta * std::cos(phi)};
+}
+
+//same as the lit vertex shaders
+glm::vec3 fromOctahedral(std::uint32_t packed, int bits)
+{
+	std::uint32_t mask = (1u << bits) - 1;
+	glm::vec2 f = glm::vec2(packed & mask, packed >> bits & mask) / float(mask) * 2.0f - 1.0f;
+	glm::vec3 n{f, 1.0f - std::abs(f.x) - std::abs(f.y)};
+	float t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
@@ -1,5 +1,6 @@
 #include "PCRenderer.h"
 #include "Scene.h"
+#include "PointCloud.h"
 #include "imgui.h"
 #include "Shader.h"
 
@@ -40,19 +41,46 @@ void PCRenderer::bindVAO() const
 	glBindVertexArray(VAO);
 }
 
+bool PCRenderer::isBrickDrawCommandStream(Span<DrawCommand const> drawCommands) const
+{
+	auto brickOffsets = cloud->getBrickOffsets();
+	std::size_t command = 0;
+	for(std::size_t brickIndex = 0; brickIndex < cloud->getBrickCount(); brickIndex++)
+	{
+		if(brickOffsets[brickIndex] == brickOffsets[brickIndex + 1])
+			continue;
+		if(command == drawCommands.size())
+			return false;
+		DrawCommand const& drawCommand = drawCommands[command++];
+		if(drawCommand.baseInstance != brickIndex || drawCommand.first != brickOffsets[brickIndex] || drawCommand.instanceCount != 1
+			|| drawCommand.count != brickOffsets[brickIndex + 1] - brickOffsets[brickIndex])
+			return false;
+	}
+	return command == drawCommands.size();
+}
+
+bool PCRenderer::isPointStream(std::size_t elementCount) const
+{
+	return elementCount == cloud->getPositions().size();
+}
+
 Shader* PCRenderer::getMainShader() const
 {
 	return mainShader;
 }
 
+void PCRenderer::setPointCloud(PointCloud const* cloud)
+{
+	if(this->cloud == cloud)
+		return;
+	this->cloud = cloud;
+	mainShader->use();
+	update();
+}
+
 void PCRenderer::render(Scene const* scene)
 {
-	if(cloud != scene->getPointCloud())
-	{
-		cloud = scene->getPointCloud();
-		mainShader->use();
-		update();
-	}
+	setPointCloud(scene->getPointCloud());
 }
 
 void PCRenderer::drawUI()
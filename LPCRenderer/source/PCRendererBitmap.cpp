@@ -1,9 +1,29 @@
 #include "PCRendererBitmap.h"
 #include "Shader.h"
 #include "PointCloud.h"
+#include "Scene.h"
+#include "Frustum.h"
 #include "imgui.h"
 
+#include <algorithm>
+#include <array>
 #include <bitset>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+enum class UnpackKernel
+{
+	atomic,
+	scan
+};
+
+enum class BitmapEncoding
+{
+	dense,
+	sparse,
+	morton
+};
 
 namespace
 {
@@ -12,10 +32,206 @@ namespace
 	Shader unpack16Shader{"shaders/pcUnpackBitmap16.comp"};
 	Shader unpack8Shader{"shaders/pcUnpackBitmap8.comp"};
 	Shader unpack4Shader{"shaders/pcUnpackBitmap4.comp"};
+	Shader unpackScan32Shader{"shaders/pcUnpackBitmapScan32.comp"};
+	Shader unpackScan16Shader{"shaders/pcUnpackBitmapScan16.comp"};
+	Shader unpackScan8Shader{"shaders/pcUnpackBitmapScan8.comp"};
+	Shader unpackScan4Shader{"shaders/pcUnpackBitmapScan4.comp"};
+	UnpackKernel unpackKernel = UnpackKernel::scan;
+	bool decompressionCache = false;
+	int cacheBudget = 512;//MiB
+	bool singleDispatch = true;
+	int segmentBudget = 256;//MiB
+	bool adaptiveEncoding = true;
+	std::array<std::size_t, 3> encodingCounts{};
 	int pointSize = 2;
 	int batchSize = 1;
 	int bitmapSize = 32;
 	Shader* unpackShader = nullptr;
+	//the cache and the single dispatch need fixed output places, so they always use the prefix sum kernels
+	Shader* scanShader = nullptr;
+	constexpr std::uint32_t noSlot = std::numeric_limits<std::uint32_t>::max();
+	constexpr std::size_t maxWorkGroupCount = 65535;
+	//output modes of the prefix sum kernels
+	constexpr unsigned int outputBatch = 0;
+	constexpr unsigned int outputCache = 1;
+	constexpr unsigned int outputSegments = 2;
+
+	bool useSingleDispatch()
+	{
+		return singleDispatch && !decompressionCache && GLAD_GL_ARB_indirect_parameters;
+	}
+
+	//the atomic kernels only read dense bitmaps
+	bool useAdaptiveEncoding()
+	{
+		return adaptiveEncoding && (unpackKernel == UnpackKernel::scan || decompressionCache || useSingleDispatch());
+	}
+
+	std::size_t getNonEmptyBrickCount(PointCloud const& cloud)
+	{
+		auto brickOffsets = cloud.getBrickOffsets();
+		std::size_t count = 0;
+		for(std::size_t brickIndex = 0; brickIndex < cloud.getBrickCount(); brickIndex++)
+			count += brickOffsets[brickIndex] != brickOffsets[brickIndex + 1];
+		return count;
+	}
+
+	std::size_t countBits(std::uint32_t const* first, std::uint32_t const* last)
+	{
+		std::size_t count = 0;
+		for(; first != last; ++first)
+			count += std::bitset<32>(*first).count();
+		return count;
+	}
+
+	//a header per brick, its word offset and its encoding in the upper two bits of its point count, followed by
+	//every brick in the smallest of three encodings, dense bitmap, sparse bitmap of the non zero words or morton codes
+	template<typename BrickBitmap>
+	Span<std::uint32_t const> getAdaptiveBitmaps(PointCloud const& cloud, Span<BrickBitmap const> bitmaps, int bitmapSize)
+	{
+		return cloud.getPackedStream<std::uint32_t>({"adaptiveBitmaps", cloud.getSubdivisions(), 0, 0, bitmapSize}, [&]() {
+			std::size_t wordCount = std::size_t(bitmapSize) * bitmapSize * bitmapSize / 32;
+			std::size_t maskWordCount = (wordCount + 31) / 32;
+			std::vector<std::uint32_t> stream(2 * bitmaps.size());
+			std::vector<std::uint32_t> codes;
+			for(std::size_t bitmap = 0; bitmap < bitmaps.size(); bitmap++)
+			{
+				//the gpu reads the bitsets as plain words as well
+				auto words = reinterpret_cast<std::uint32_t const*>(&bitmaps[bitmap]);
+				std::size_t pointCount = bitmaps[bitmap].count();
+				std::size_t nonZeroCount = std::count_if(words, words + wordCount, [](std::uint32_t word) { return word != 0; });
+				std::size_t denseSize = wordCount;
+				std::size_t sparseSize = maskWordCount + nonZeroCount;
+				std::size_t mortonSize = (pointCount + 1) / 2;
+
+				BitmapEncoding encoding = BitmapEncoding::dense;
+				if(sparseSize < denseSize)
+					encoding = BitmapEncoding::sparse;
+				if(mortonSize < std::min(denseSize, sparseSize))
+					encoding = BitmapEncoding::morton;
+				stream[2 * bitmap] = static_cast<std::uint32_t>(stream.size());
+				stream[2 * bitmap + 1] = static_cast<std::uint32_t>(encoding) << 30 | pointCount;
+
+				switch(encoding)
+				{
+					case BitmapEncoding::dense:
+						stream.insert(stream.end(), words, words + wordCount);
+						break;
+					case BitmapEncoding::sparse:
+					{
+						std::size_t maskStart = stream.size();
+						stream.resize(stream.size() + maskWordCount, 0);
+						for(std::size_t word = 0; word < wordCount; word++)
+						{
+							if(words[word] == 0)
+								continue;
+							stream[maskStart + word / 32] |= 1u << (word % 32);
+							stream.push_back(words[word]);
+						}
+						break;
+					}
+					case BitmapEncoding::morton:
+					{
+						codes.clear();
+						for(std::size_t word = 0; word < wordCount; word++)
+						{
+							for(std::size_t bit = 0; bit < 32; bit++)
+							{
+								if(!(words[word] >> bit & 1))
+									continue;
+								std::size_t idx = word * 32 + bit;
+								glm::uvec3 cell(idx % bitmapSize, idx / bitmapSize % bitmapSize, idx / (bitmapSize * bitmapSize));
+								codes.push_back(encodeMorton(cell));
+							}
+						}
+						std::sort(codes.begin(), codes.end());
+						codes.resize(2 * mortonSize, 0);
+						for(std::size_t code = 0; code < codes.size(); code += 2)
+							stream.push_back(codes[code] | codes[code + 1] << 16);
+						break;
+					}
+				}
+			}
+			return stream;
+		}, [&](Span<std::uint32_t const> stream) {
+			//the kernels unpack as many points as the encoded bits hold into the range reserved for the header's count
+			std::size_t wordCount = std::size_t(bitmapSize) * bitmapSize * bitmapSize / 32;
+			std::size_t maskWordCount = (wordCount + 31) / 32;
+			if(stream.size() < 2 * bitmaps.size())
+				return false;
+			for(std::size_t bitmap = 0; bitmap < bitmaps.size(); bitmap++)
+			{
+				std::size_t offset = stream[2 * bitmap];
+				std::size_t pointCount = stream[2 * bitmap + 1] & 0x3FFFFFFFu;
+				if(pointCount != bitmaps[bitmap].count() || offset > stream.size())
+					return false;
+				std::uint32_t const* data = stream.data() + offset;
+				std::size_t available = stream.size() - offset;
+				switch(static_cast<BitmapEncoding>(stream[2 * bitmap + 1] >> 30))
+				{
+					case BitmapEncoding::dense:
+						if(available < wordCount || countBits(data, data + wordCount) != pointCount)
+							return false;
+						break;
+					case BitmapEncoding::sparse:
+					{
+						if(available < maskWordCount || (wordCount % 32 != 0 && data[maskWordCount - 1] >> (wordCount % 32) != 0))
+							return false;
+						std::size_t nonZeroCount = countBits(data, data + maskWordCount);
+						if(available - maskWordCount < nonZeroCount || countBits(data + maskWordCount, data + maskWordCount + nonZeroCount) != pointCount)
+							return false;
+						break;
+					}
+					case BitmapEncoding::morton:
+						if(available < (pointCount + 1) / 2)
+							return false;
+						break;
+					default:
+						return false;
+				}
+			}
+			return true;
+		});
+	}
+
+	template<typename BrickBitmap>
+	std::pair<std::byte const*, std::size_t> getBitmapsData(PointCloud const& cloud, Span<BrickBitmap const> bitmaps, int bitmapSize)
+	{
+		if(!useAdaptiveEncoding())
+			return {(std::byte const*)bitmaps.data(), bitmaps.sizeInBytes()};
+
+		auto adaptiveBitmaps = getAdaptiveBitmaps(cloud, bitmaps, bitmapSize);
+		encodingCounts.fill(0);
+		for(std::size_t bitmap = 0; bitmap < bitmaps.size(); bitmap++)
+			encodingCounts[adaptiveBitmaps[2 * bitmap + 1] >> 30]++;
+		return {(std::byte const*)adaptiveBitmaps.data(), adaptiveBitmaps.sizeInBytes()};
+	}
+
+	//the offsets of the bricks if all of them were unpacked back to back, plus the total at the end
+	template<typename BrickBitmap>
+	Span<std::uint32_t const> getPositionOffsets(PointCloud const& cloud, Span<BrickBitmap const> bitmaps, int bitmapSize)
+	{
+		return cloud.getPackedStream<std::uint32_t>({"bitmapPositionOffsets", cloud.getSubdivisions(), 0, 0, bitmapSize}, [&]() {
+			std::vector<std::uint32_t> positionOffsets(bitmaps.size() + 1, 0);
+			for(std::size_t bitmap = 0; bitmap < bitmaps.size(); bitmap++)
+			{
+				//two positions share a word, so every brick has to start on an even position
+				std::size_t pointCount = bitmaps[bitmap].count();
+				positionOffsets[bitmap + 1] = positionOffsets[bitmap] + pointCount + pointCount % 2;
+			}
+			return positionOffsets;
+		}, [&](Span<std::uint32_t const> positionOffsets) {
+			if(positionOffsets.size() != bitmaps.size() + 1 || positionOffsets[0] != 0)
+				return false;
+			for(std::size_t bitmap = 0; bitmap < bitmaps.size(); bitmap++)
+			{
+				std::size_t pointCount = bitmaps[bitmap].count();
+				if(positionOffsets[bitmap + 1] != positionOffsets[bitmap] + pointCount + pointCount % 2)
+					return false;
+			}
+			return true;
+		});
+	}
 }
 
 PCRendererBitmap::PCRendererBitmap()
@@ -24,39 +240,66 @@ PCRendererBitmap::PCRendererBitmap()
 	Counter.reserve(4);
 }
 
+Span<std::uint32_t const> PCRendererBitmap::getBitmapIndices() const
+{
+	//the same for every bitmap size, one entry per non empty brick
+	return cloud->getPackedStream<std::uint32_t>({"bitmapIndices", cloud->getSubdivisions()}, [&]() {
+		std::vector<std::uint32_t> bitmapIndices;
+		int brickIndex = -1;
+		for(auto const& brick : cloud->getAllBricks())
+		{
+			brickIndex++;
+			if(!brick.positions.empty())
+				bitmapIndices.push_back(brickIndex);
+		}
+		return bitmapIndices;
+	}, [&](Span<std::uint32_t const> bitmapIndices) {
+		auto brickOffsets = cloud->getBrickOffsets();
+		std::size_t bitmap = 0;
+		for(std::size_t brickIndex = 0; brickIndex < cloud->getBrickCount(); brickIndex++)
+		{
+			if(brickOffsets[brickIndex] == brickOffsets[brickIndex + 1])
+				continue;
+			if(bitmap == bitmapIndices.size() || bitmapIndices[bitmap++] != brickIndex)
+				return false;
+		}
+		return bitmap == bitmapIndices.size();
+	});
+}
+
 void PCRendererBitmap::update32()
 {
 	constexpr std::size_t bitmapSize = 32;
 	using BrickBitmap = std::bitset<bitmapSize * bitmapSize * bitmapSize>;
-	static BrickBitmap auxBitmap;
-	static std::vector<BrickBitmap> bitmaps;
-	bitmaps.clear();
-	std::vector<std::uint32_t> bitmapIndices;
-	int brickIndex = -1;
-	totalBrickCount = 0;
-	for(auto brick : cloud->getAllBricks())
-	{
-		brickIndex++;
-		if(brick.positions.empty())
-			continue;
-		totalBrickCount++;
-		auxBitmap.reset();
-		for(auto const& position : brick.positions)
+	auto bitmaps = cloud->getPackedStream<BrickBitmap>({"bitmaps", cloud->getSubdivisions(), 0, 0, bitmapSize}, [&]() {
+		std::vector<BrickBitmap> bitmaps;
+		BrickBitmap auxBitmap;
+		for(auto const& brick : cloud->getAllBricks())
 		{
-			glm::ivec3 coordinates(position * float(bitmapSize));
-			int idx = 0;
-			idx += coordinates.x;//jump points
-			idx += coordinates.y * bitmapSize;//jump lines
-			idx += coordinates.z * bitmapSize * bitmapSize;//jump surfaces
-			auxBitmap.set(idx, true);
+			if(brick.positions.empty())
+				continue;
+			auxBitmap.reset();
+			for(auto const& position : brick.positions)
+			{
+				glm::ivec3 coordinates(position * float(bitmapSize));
+				int idx = 0;
+				idx += coordinates.x;//jump points
+				idx += coordinates.y * bitmapSize;//jump lines
+				idx += coordinates.z * bitmapSize * bitmapSize;//jump surfaces
+				auxBitmap.set(idx, true);
+			}
+			bitmaps.push_back(auxBitmap);
 		}
-		bitmapIndices.push_back(brickIndex);
-		bitmaps.push_back(auxBitmap);
-	}
+		return bitmaps;
+	}, [&](Span<BrickBitmap const> bitmaps) {
+		return bitmaps.size() == getNonEmptyBrickCount(*cloud);
+	});
+	auto bitmapIndices = getBitmapIndices();
+	totalBrickCount = bitmapIndices.size();
 
 	bindVAO();
-	SSBOBitmaps.write({{(std::byte const*)bitmaps.data(), sizeInBytes(bitmaps)}});
-	SSBOBitmapIndices.write({{(std::byte const*)bitmapIndices.data(), sizeInBytes(bitmapIndices)}});
+	SSBOBitmaps.write({getBitmapsData(*cloud, bitmaps, bitmapSize)});
+	SSBOBitmapIndices.write({{(std::byte const*)bitmapIndices.data(), bitmapIndices.sizeInBytes()}});
 	std::size_t positionCount = batchSize * bitmapSize * bitmapSize * bitmapSize;
 	SSBOPackedPositions.reserve((positionCount + positionCount % 2) * sizeof(std::uint16_t));
 	SSBOPackedPositions.bind(GL_ARRAY_BUFFER);
@@ -64,41 +307,44 @@ void PCRendererBitmap::update32()
 	glVertexAttribIPointer(0, 1, GL_UNSIGNED_SHORT, 0, (void*)(0));
 
 	SSBODrawCommands.reserve(batchSize * sizeof(DrawCommand));
+
+	if(useSingleDispatch())
+		updateSegments(getPositionOffsets(*cloud, bitmaps, bitmapSize));
 }
 
 void PCRendererBitmap::update16()
 {
 	constexpr std::size_t bitmapSize = 16;
 	using BrickBitmap = std::bitset<bitmapSize * bitmapSize * bitmapSize>;
-	static BrickBitmap auxBitmap;
-	static std::vector<BrickBitmap> bitmaps;
-	bitmaps.clear();
-	std::vector<std::uint32_t> bitmapIndices;
-	int brickIndex = -1;
-	totalBrickCount = 0;
-	for(auto brick : cloud->getAllBricks())
-	{
-		brickIndex++;
-		if(brick.positions.empty())
-			continue;
-		totalBrickCount++;
-		auxBitmap.reset();
-		for(auto const& position : brick.positions)
+	auto bitmaps = cloud->getPackedStream<BrickBitmap>({"bitmaps", cloud->getSubdivisions(), 0, 0, bitmapSize}, [&]() {
+		std::vector<BrickBitmap> bitmaps;
+		BrickBitmap auxBitmap;
+		for(auto const& brick : cloud->getAllBricks())
 		{
-			glm::ivec3 coordinates(position * float(bitmapSize));
-			int idx = 0;
-			idx += coordinates.x;//jump points
-			idx += coordinates.y * bitmapSize;//jump lines
-			idx += coordinates.z * bitmapSize * bitmapSize;//jump surfaces
-			auxBitmap.set(idx, true);
+			if(brick.positions.empty())
+				continue;
+			auxBitmap.reset();
+			for(auto const& position : brick.positions)
+			{
+				glm::ivec3 coordinates(position * float(bitmapSize));
+				int idx = 0;
+				idx += coordinates.x;//jump points
+				idx += coordinates.y * bitmapSize;//jump lines
+				idx += coordinates.z * bitmapSize * bitmapSize;//jump surfaces
+				auxBitmap.set(idx, true);
+			}
+			bitmaps.push_back(auxBitmap);
 		}
-		bitmapIndices.push_back(brickIndex);
-		bitmaps.push_back(auxBitmap);
-	}
+		return bitmaps;
+	}, [&](Span<BrickBitmap const> bitmaps) {
+		return bitmaps.size() == getNonEmptyBrickCount(*cloud);
+	});
+	auto bitmapIndices = getBitmapIndices();
+	totalBrickCount = bitmapIndices.size();
 
 	bindVAO();
-	SSBOBitmaps.write({{(std::byte const*)bitmaps.data(), sizeInBytes(bitmaps)}});
-	SSBOBitmapIndices.write({{(std::byte const*)bitmapIndices.data(), sizeInBytes(bitmapIndices)}});
+	SSBOBitmaps.write({getBitmapsData(*cloud, bitmaps, bitmapSize)});
+	SSBOBitmapIndices.write({{(std::byte const*)bitmapIndices.data(), bitmapIndices.sizeInBytes()}});
 	std::size_t positionCount = batchSize * bitmapSize * bitmapSize * bitmapSize;
 	SSBOPackedPositions.reserve((positionCount + positionCount % 2) * sizeof(std::uint16_t));
 	SSBOPackedPositions.bind(GL_ARRAY_BUFFER);
@@ -106,41 +352,44 @@ void PCRendererBitmap::update16()
 	glVertexAttribIPointer(0, 1, GL_UNSIGNED_SHORT, 0, (void*)(0));
 
 	SSBODrawCommands.reserve(batchSize * sizeof(DrawCommand));
+
+	if(useSingleDispatch())
+		updateSegments(getPositionOffsets(*cloud, bitmaps, bitmapSize));
 }
 
 void PCRendererBitmap::update8()
 {
 	constexpr std::size_t bitmapSize = 8;
 	using BrickBitmap = std::bitset<bitmapSize * bitmapSize * bitmapSize>;
-	static BrickBitmap auxBitmap;
-	static std::vector<BrickBitmap> bitmaps;
-	bitmaps.clear();
-	std::vector<std::uint32_t> bitmapIndices;
-	int brickIndex = -1;
-	totalBrickCount = 0;
-	for(auto brick : cloud->getAllBricks())
-	{
-		brickIndex++;
-		if(brick.positions.empty())
-			continue;
-		totalBrickCount++;
-		auxBitmap.reset();
-		for(auto const& position : brick.positions)
+	auto bitmaps = cloud->getPackedStream<BrickBitmap>({"bitmaps", cloud->getSubdivisions(), 0, 0, bitmapSize}, [&]() {
+		std::vector<BrickBitmap> bitmaps;
+		BrickBitmap auxBitmap;
+		for(auto const& brick : cloud->getAllBricks())
 		{
-			glm::ivec3 coordinates(position * float(bitmapSize));
-			int idx = 0;
-			idx += coordinates.x;//jump points
-			idx += coordinates.y * bitmapSize;//jump lines
-			idx += coordinates.z * bitmapSize * bitmapSize;//jump surfaces
-			auxBitmap.set(idx, true);
+			if(brick.positions.empty())
+				continue;
+			auxBitmap.reset();
+			for(auto const& position : brick.positions)
+			{
+				glm::ivec3 coordinates(position * float(bitmapSize));
+				int idx = 0;
+				idx += coordinates.x;//jump points
+				idx += coordinates.y * bitmapSize;//jump lines
+				idx += coordinates.z * bitmapSize * bitmapSize;//jump surfaces
+				auxBitmap.set(idx, true);
+			}
+			bitmaps.push_back(auxBitmap);
 		}
-		bitmapIndices.push_back(brickIndex);
-		bitmaps.push_back(auxBitmap);
-	}
+		return bitmaps;
+	}, [&](Span<BrickBitmap const> bitmaps) {
+		return bitmaps.size() == getNonEmptyBrickCount(*cloud);
+	});
+	auto bitmapIndices = getBitmapIndices();
+	totalBrickCount = bitmapIndices.size();
 
 	bindVAO();
-	SSBOBitmaps.write({{(std::byte const*)bitmaps.data(), sizeInBytes(bitmaps)}});
-	SSBOBitmapIndices.write({{(std::byte const*)bitmapIndices.data(), sizeInBytes(bitmapIndices)}});
+	SSBOBitmaps.write({getBitmapsData(*cloud, bitmaps, bitmapSize)});
+	SSBOBitmapIndices.write({{(std::byte const*)bitmapIndices.data(), bitmapIndices.sizeInBytes()}});
 	std::size_t positionCount = batchSize * bitmapSize * bitmapSize * bitmapSize;
 	SSBOPackedPositions.reserve((positionCount + positionCount % 2) * sizeof(std::uint16_t));
 	SSBOPackedPositions.bind(GL_ARRAY_BUFFER);
@@ -148,41 +397,44 @@ void PCRendererBitmap::update8()
 	glVertexAttribIPointer(0, 1, GL_UNSIGNED_SHORT, 0, (void*)(0));
 
 	SSBODrawCommands.reserve(batchSize * sizeof(DrawCommand));
+
+	if(useSingleDispatch())
+		updateSegments(getPositionOffsets(*cloud, bitmaps, bitmapSize));
 }
 
 void PCRendererBitmap::update4()
 {
 	constexpr std::size_t bitmapSize = 4;
 	using BrickBitmap = std::bitset<bitmapSize * bitmapSize * bitmapSize>;
-	static BrickBitmap auxBitmap;
-	static std::vector<BrickBitmap> bitmaps;
-	bitmaps.clear();
-	std::vector<std::uint32_t> bitmapIndices;
-	int brickIndex = -1;
-	totalBrickCount = 0;
-	for(auto brick : cloud->getAllBricks())
-	{
-		brickIndex++;
-		if(brick.positions.empty())
-			continue;
-		totalBrickCount++;
-		auxBitmap.reset();
-		for(auto const& position : brick.positions)
+	auto bitmaps = cloud->getPackedStream<BrickBitmap>({"bitmaps", cloud->getSubdivisions(), 0, 0, bitmapSize}, [&]() {
+		std::vector<BrickBitmap> bitmaps;
+		BrickBitmap auxBitmap;
+		for(auto const& brick : cloud->getAllBricks())
 		{
-			glm::ivec3 coordinates(position * float(bitmapSize));
-			int idx = 0;
-			idx += coordinates.x;//jump points
-			idx += coordinates.y * bitmapSize;//jump lines
-			idx += coordinates.z * bitmapSize * bitmapSize;//jump surfaces
-			auxBitmap.set(idx, true);
+			if(brick.positions.empty())
+				continue;
+			auxBitmap.reset();
+			for(auto const& position : brick.positions)
+			{
+				glm::ivec3 coordinates(position * float(bitmapSize));
+				int idx = 0;
+				idx += coordinates.x;//jump points
+				idx += coordinates.y * bitmapSize;//jump lines
+				idx += coordinates.z * bitmapSize * bitmapSize;//jump surfaces
+				auxBitmap.set(idx, true);
+			}
+			bitmaps.push_back(auxBitmap);
 		}
-		bitmapIndices.push_back(brickIndex);
-		bitmaps.push_back(auxBitmap);
-	}
+		return bitmaps;
+	}, [&](Span<BrickBitmap const> bitmaps) {
+		return bitmaps.size() == getNonEmptyBrickCount(*cloud);
+	});
+	auto bitmapIndices = getBitmapIndices();
+	totalBrickCount = bitmapIndices.size();
 
 	bindVAO();
-	SSBOBitmaps.write({{(std::byte const*)bitmaps.data(), sizeInBytes(bitmaps)}});
-	SSBOBitmapIndices.write({{(std::byte const*)bitmapIndices.data(), sizeInBytes(bitmapIndices)}});
+	SSBOBitmaps.write({getBitmapsData(*cloud, bitmaps, bitmapSize)});
+	SSBOBitmapIndices.write({{(std::byte const*)bitmapIndices.data(), bitmapIndices.sizeInBytes()}});
 	std::size_t positionCount = batchSize * bitmapSize * bitmapSize * bitmapSize;
 	SSBOPackedPositions.reserve((positionCount + positionCount % 2) * sizeof(std::uint16_t));
 	SSBOPackedPositions.bind(GL_ARRAY_BUFFER);
@@ -190,45 +442,258 @@ void PCRendererBitmap::update4()
 	glVertexAttribIPointer(0, 1, GL_UNSIGNED_SHORT, 0, (void*)(0));
 
 	SSBODrawCommands.reserve(batchSize * sizeof(DrawCommand));
+
+	if(useSingleDispatch())
+		updateSegments(getPositionOffsets(*cloud, bitmaps, bitmapSize));
 }
 
 void PCRendererBitmap::update()
 {
 	cloud->setBrickPrecision(bitmapSize);
+	if(!useSingleDispatch())
+	{
+		SSBOSegmentPositions.free();
+		SSBOSegmentPositionOffsets.free();
+		SSBOSegmentDrawCommands.free();
+		SSBOSegmentDrawCounts.free();
+		segmentPasses.clear();
+	}
 
+	bool scan = unpackKernel == UnpackKernel::scan;
 	switch(bitmapSize)
 	{
 		case 32:
-			unpackShader = &unpack32Shader;
+			unpackShader = scan ? &unpackScan32Shader : &unpack32Shader;
+			scanShader = &unpackScan32Shader;
 			update32();
 			break;
 		case 16:
-			unpackShader = &unpack16Shader;
+			unpackShader = scan ? &unpackScan16Shader : &unpack16Shader;
+			scanShader = &unpackScan16Shader;
 			update16();
 			break;
 		case 8:
-			unpackShader = &unpack8Shader;
+			unpackShader = scan ? &unpackScan8Shader : &unpack8Shader;
+			scanShader = &unpackScan8Shader;
 			update8();
 			break;
 		case 4:
-			unpackShader = &unpack4Shader;
+			unpackShader = scan ? &unpackScan4Shader : &unpack4Shader;
+			scanShader = &unpackScan4Shader;
 			update4();
 			break;
 	}
+	resetCache();
 }
 
-void PCRendererBitmap::render(Scene const* scene)
+void PCRendererBitmap::updateSegments(Span<std::uint32_t const> positionOffsets)
 {
-	PCRenderer::render(scene);
+	//bricks are grouped into passes whose positions fit into one segment, if the whole cloud does not fit
+	//a second segment lets the next pass be unpacked while the previous one is still drawn
+	segmentPositionOffsets.assign(positionOffsets.begin(), positionOffsets.end());
+	std::size_t totalPositionCount = positionOffsets[totalBrickCount];
+	std::size_t budgetPositionCount = std::size_t(segmentBudget) * 1024 * 1024 / sizeof(std::uint16_t);
+	segmentCount = 1;
+	segmentPositionCount = std::max<std::size_t>(totalPositionCount, 2);
+	if(totalPositionCount > budgetPositionCount)
+	{
+		segmentCount = 2;
+		segmentPositionCount = std::max<std::size_t>(budgetPositionCount / 2, bitmapSize * bitmapSize * bitmapSize);
+	}
 
-	mainShader->set("cloudOrigin", cloud->getBounds().first);
-	mainShader->set("brickSize", cloud->getBrickSize());
-	mainShader->set("subdivisions", glm::uvec3(cloud->getSubdivisions()));
-	mainShader->set("positionSize", 16);
+	segmentPasses.clear();
+	std::size_t firstBrick = 0;
+	while(firstBrick < totalBrickCount)
+	{
+		segmentPasses.push_back(firstBrick);
+		std::size_t endBrick = firstBrick + 1;
+		while(endBrick < totalBrickCount && positionOffsets[endBrick + 1] - positionOffsets[firstBrick] <= segmentPositionCount)
+			endBrick++;
+		firstBrick = endBrick;
+	}
+	segmentPasses.push_back(totalBrickCount);
 
 	bindVAO();
-	unpackShader->use();
+	SSBOSegmentPositionOffsets.write({{(std::byte const*)positionOffsets.data(), positionOffsets.sizeInBytes()}});
+	SSBOSegmentPositions.reserve(segmentCount * segmentPositionCount * sizeof(std::uint16_t));
+	SSBOSegmentPositions.bind(GL_ARRAY_BUFFER);
+	glVertexAttribIPointer(0, 1, GL_UNSIGNED_SHORT, 0, (void*)(0));
+	SSBOSegmentDrawCommands.reserve(std::max<std::size_t>(totalBrickCount, 1) * sizeof(DrawCommand));
+	SSBOSegmentDrawCounts.reserve(segmentPasses.size() * sizeof(GLuint));
+}
+
+void PCRendererBitmap::renderSegments(Scene const* scene)
+{
+	glm::mat4 modelViewProjection = scene->getCamera().getProjectionMatrix() * scene->getCamera().getViewMatrix() * scene->getModelMatrix();
+
+	SSBOSegmentDrawCounts.clear();
+	SSBOBitmaps.bindBase(0);
+	SSBOBitmapIndices.bindBase(1);
+	SSBOSegmentPositions.bindBase(2);
+	SSBOSegmentDrawCommands.bindBase(3);
+	SSBOSegmentPositionOffsets.bindBase(5);
+	SSBOSegmentDrawCounts.bindBase(6);
+	SSBOSegmentDrawCommands.bind(GL_DRAW_INDIRECT_BUFFER);
+	SSBOSegmentDrawCounts.bind(GL_PARAMETER_BUFFER_ARB);
+
+	scanShader->use();
+	scanShader->set("outputMode", outputSegments);
+	scanShader->set("adaptiveEncoding", useAdaptiveEncoding());
+	scanShader->set("modelViewProjection", modelViewProjection);
+	scanShader->set("cloudOrigin", cloud->getBounds().first);
+	scanShader->set("brickSize", cloud->getBrickSize());
+	scanShader->set("subdivisions", glm::uvec3(cloud->getSubdivisions()));
+
+	//one dispatch and one draw per pass, usually the whole cloud fits into a single pass
+	for(std::size_t pass = 0; pass + 1 < segmentPasses.size(); pass++)
+	{
+		std::size_t firstBrick = segmentPasses[pass];
+		std::size_t endBrick = segmentPasses[pass + 1];
+		std::size_t segmentStart = (pass % segmentCount) * segmentPositionCount;
+
+		scanShader->use();
+		scanShader->set("positionsOffset", static_cast<unsigned int>(segmentPositionOffsets[firstBrick] - segmentStart));
+		scanShader->set("drawCommandsOffset", static_cast<unsigned int>(firstBrick));
+		scanShader->set("segmentPass", static_cast<unsigned int>(pass));
+		for(std::size_t chunk = firstBrick; chunk < endBrick; chunk += maxWorkGroupCount)
+		{
+			scanShader->set("bitmapsOffset", chunk);
+			glDispatchCompute(std::min(maxWorkGroupCount, endBrick - chunk), 1, 1);
+		}
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+		mainShader->use();
+		glMultiDrawArraysIndirectCountARB(GL_POINTS, (void*)(firstBrick * sizeof(DrawCommand)), pass * sizeof(GLuint), endBrick - firstBrick, 0);
+	}
+}
+
+void PCRendererBitmap::resetCache()
+{
+	cacheSlotBitmaps.clear();
+	cacheSlotLastUse.clear();
+	cacheLRU.clear();
+	cacheLRUPositions.clear();
+	bitmapCacheSlots.clear();
+	visibleCacheSlots.clear();
+	cacheFrame = 0;
+	if(!decompressionCache)
+	{
+		SSBOCachePositions.free();
+		SSBOCacheDrawCommands.free();
+		SSBOCacheRequests.free();
+		return;
+	}
+
+	std::size_t slotPositionCount = bitmapSize * bitmapSize * bitmapSize;
+	std::size_t slotBytes = slotPositionCount * sizeof(std::uint16_t) + sizeof(DrawCommand);
+	std::size_t slotCount = std::min(std::size_t(cacheBudget) * 1024 * 1024 / slotBytes, totalBrickCount);
+	slotCount = std::max<std::size_t>(slotCount, 1);
+
+	cacheSlotBitmaps.resize(slotCount, noSlot);
+	cacheSlotLastUse.resize(slotCount, 0);
+	for(std::uint32_t slot = 0; slot < slotCount; slot++)
+		cacheLRUPositions.push_back(cacheLRU.insert(cacheLRU.end(), slot));
+	bitmapCacheSlots.resize(totalBrickCount, noSlot);
+
+	bindVAO();
+	SSBOCachePositions.reserve(slotCount * slotPositionCount * sizeof(std::uint16_t));
+	SSBOCachePositions.bind(GL_ARRAY_BUFFER);
+	glVertexAttribIPointer(0, 1, GL_UNSIGNED_SHORT, 0, (void*)(0));
+	//empty slots keep a zero draw command, hidden ones get their instance count zeroed
+	SSBOCacheDrawCommands.reserve(slotCount * sizeof(DrawCommand), GL_DYNAMIC_STORAGE_BIT);
+	SSBOCacheDrawCommands.clear();
+	SSBOCacheRequests.reserve(slotCount * sizeof(glm::uvec2), GL_DYNAMIC_STORAGE_BIT);
+}
+
+void PCRendererBitmap::updateCache(Scene const* scene)
+{
+	cacheFrame++;
+	glm::mat4 modelView = scene->getCamera().getViewMatrix() * scene->getModelMatrix();
+	glm::mat4 modelViewProjection = scene->getCamera().getProjectionMatrix() * modelView;
+	glm::vec3 cameraPosition = glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	//closest bricks first, so those are the ones kept when the visible bricks do not fit into the budget
+	auto bitmapIndices = getBitmapIndices();
+	std::vector<std::pair<float, std::uint32_t>> visibleBitmaps;
+	for(std::uint32_t bitmap = 0; bitmap < bitmapIndices.size(); bitmap++)
+	{
+		auto bounds = cloud->getBoundsAt(cloud->getBrickAt(bitmapIndices[bitmap]).indices);
+		if(isOutsideFrustum(modelViewProjection, bounds))
+			continue;
+		visibleBitmaps.emplace_back(glm::distance(cameraPosition, (bounds.first + bounds.second) * 0.5f), bitmap);
+	}
+	std::sort(visibleBitmaps.begin(), visibleBitmaps.end());
+
+	std::vector<glm::uvec2> requests;
+	DrawCommand shown{};
+	cacheOverBudgetCount = 0;
+	for(auto [distance, bitmap] : visibleBitmaps)
+	{
+		std::uint32_t slot = bitmapCacheSlots[bitmap];
+		if(slot == noSlot)
+		{
+			//the least recently used slot is only free to take if it is not drawn this frame
+			slot = cacheLRU.front();
+			if(cacheSlotLastUse[slot] == cacheFrame)
+			{
+				cacheOverBudgetCount++;
+				continue;
+			}
+			if(cacheSlotBitmaps[slot] != noSlot)
+				bitmapCacheSlots[cacheSlotBitmaps[slot]] = noSlot;
+			cacheSlotBitmaps[slot] = bitmap;
+			bitmapCacheSlots[bitmap] = slot;
+			requests.emplace_back(bitmap, slot);
+		}
+		else if(cacheSlotLastUse[slot] != cacheFrame - 1)
+		{
+			//cached but hidden last frame
+			SSBOCacheDrawCommands.update(slot * sizeof(DrawCommand) + offsetof(DrawCommand, instanceCount),
+				(std::byte const*)&shown.instanceCount, sizeof(shown.instanceCount));
+		}
+		cacheSlotLastUse[slot] = cacheFrame;
+		cacheLRU.splice(cacheLRU.end(), cacheLRU, cacheLRUPositions[slot]);
+	}
+
+	DrawCommand hidden{};
+	hidden.instanceCount = 0;
+	for(auto slot : visibleCacheSlots)
+	{
+		if(cacheSlotLastUse[slot] == cacheFrame)
+			continue;
+		SSBOCacheDrawCommands.update(slot * sizeof(DrawCommand) + offsetof(DrawCommand, instanceCount),
+			(std::byte const*)&hidden.instanceCount, sizeof(hidden.instanceCount));
+	}
+	visibleCacheSlots.clear();
+	for(auto [distance, bitmap] : visibleBitmaps)
+	{
+		if(bitmapCacheSlots[bitmap] != noSlot)
+			visibleCacheSlots.push_back(bitmapCacheSlots[bitmap]);
+	}
 
+	cacheMissCount = requests.size();
+	if(requests.empty())
+		return;
+	SSBOCacheRequests.update(0, (std::byte const*)requests.data(), sizeInBytes(requests));
+	SSBOBitmaps.bindBase(0);
+	SSBOBitmapIndices.bindBase(1);
+	SSBOCachePositions.bindBase(2);
+	SSBOCacheDrawCommands.bindBase(3);
+	SSBOCacheRequests.bindBase(4);
+	scanShader->use();
+	scanShader->set("outputMode", outputCache);
+	scanShader->set("adaptiveEncoding", useAdaptiveEncoding());
+	for(std::size_t firstRequest = 0; firstRequest < requests.size(); firstRequest += maxWorkGroupCount)
+	{
+		scanShader->set("bitmapsOffset", firstRequest);
+		glDispatchCompute(std::min(maxWorkGroupCount, requests.size() - firstRequest), 1, 1);
+	}
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void PCRendererBitmap::bindUnpackBuffers()
+{
+	bindVAO();
 	SSBOBitmaps.bindBase(0);
 	SSBOBitmapIndices.bindBase(1);
 	SSBOPackedPositions.bindBase(2);
@@ -236,19 +701,117 @@ void PCRendererBitmap::render(Scene const* scene)
 	SSBODrawCommands.bindBase(3);
 	SSBODrawCommands.bind(GL_DRAW_INDIRECT_BUFFER);
 	Counter.bindBase(0);
+}
+
+void PCRendererBitmap::unpackBatch(std::size_t firstBrick, std::size_t brickCount)
+{
+	//only the atomic kernel uses the counter, the scan kernel gives every brick a fixed output range
+	if(unpackKernel == UnpackKernel::atomic)
+		Counter.clear();
+
+	unpackShader->use();
+	//the atomic kernels only declare bitmapsOffset
+	if(unpackKernel == UnpackKernel::scan)
+	{
+		unpackShader->set("outputMode", outputBatch);
+		unpackShader->set("adaptiveEncoding", useAdaptiveEncoding());
+	}
+	unpackShader->set("bitmapsOffset", firstBrick);
+	glDispatchCompute(brickCount, 1, 1);
+}
+
+std::vector<PCRendererBitmap::UnpackTiming> PCRendererBitmap::benchmarkUnpacking(int repetitions)
+{
+	int previousBitmapSize = bitmapSize;
+	UnpackKernel previousKernel = unpackKernel;
+	//both kernels are timed on the batched path with dense bitmaps
+	bool previousDecompressionCache = std::exchange(decompressionCache, false);
+	bool previousSingleDispatch = std::exchange(singleDispatch, false);
+	bool previousAdaptiveEncoding = std::exchange(adaptiveEncoding, false);
+
+	GLuint query;
+	glGenQueries(1, &query);
+	std::vector<UnpackTiming> timings;
+	for(int size : {32, 16, 8, 4})
+	{
+		UnpackTiming timing;
+		timing.bitmapSize = size;
+		bitmapSize = size;
+		for(auto kernel : {UnpackKernel::atomic, UnpackKernel::scan})
+		{
+			unpackKernel = kernel;
+			update();
+			bindUnpackBuffers();
+			GLuint64 totalElapsed = 0;
+			for(int repetition = 0; repetition < repetitions; repetition++)
+			{
+				//the draws are left out, only the unpacking of every batch is timed
+				glBeginQuery(GL_TIME_ELAPSED, query);
+				for(std::size_t firstBrick = 0; firstBrick < totalBrickCount; firstBrick += batchSize)
+				{
+					unpackBatch(firstBrick, std::min<std::size_t>(batchSize, totalBrickCount - firstBrick));
+					glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
+				}
+				glEndQuery(GL_TIME_ELAPSED);
+				GLuint64 elapsed = 0;
+				glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+				totalElapsed += elapsed;
+			}
+			std::chrono::nanoseconds average(totalElapsed / std::max(repetitions, 1));
+			if(kernel == UnpackKernel::atomic)
+				timing.atomic = average;
+			else
+				timing.scan = average;
+		}
+		timings.push_back(timing);
+	}
+	glDeleteQueries(1, &query);
+
+	bitmapSize = previousBitmapSize;
+	unpackKernel = previousKernel;
+	decompressionCache = previousDecompressionCache;
+	singleDispatch = previousSingleDispatch;
+	adaptiveEncoding = previousAdaptiveEncoding;
+	update();
+	return timings;
+}
+
+void PCRendererBitmap::render(Scene const* scene)
+{
+	PCRenderer::render(scene);
+
+	mainShader->set("cloudOrigin", cloud->getBounds().first);
+	mainShader->set("brickSize", cloud->getBrickSize());
+	mainShader->set("subdivisions", glm::uvec3(cloud->getSubdivisions()));
+	mainShader->set("positionSize", 16);
+
 	glPointSize(pointSize);
+	if(decompressionCache)
+	{
+		//only newly visible bricks are unpacked, everything else is drawn straight from the cache
+		bindVAO();
+		updateCache(scene);
+		mainShader->use();
+		SSBOCacheDrawCommands.bind(GL_DRAW_INDIRECT_BUFFER);
+		glMultiDrawArraysIndirect(GL_POINTS, nullptr, cacheSlotBitmaps.size(), 0);
+		return;
+	}
+	if(useSingleDispatch())
+	{
+		bindVAO();
+		renderSegments(scene);
+		return;
+	}
+
+	bindUnpackBuffers();
 
 	int remainingBricks = totalBrickCount;
 	while(remainingBricks > 0)
 	{
-		Counter.clear();
-
-		unpackShader->use();
-		unpackShader->set("bitmapsOffset", totalBrickCount - remainingBricks);
 		int brickCount = batchSize;
 		if(remainingBricks < batchSize)
 			brickCount = remainingBricks;
-		glDispatchCompute(brickCount, 1, 1);
+		unpackBatch(totalBrickCount - remainingBricks, brickCount);
 		mainShader->use();
 		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
 
@@ -288,8 +851,59 @@ void PCRendererBitmap::drawUI()
 		update();
 	}
 
+	ImGui::Text("Unpack Kernel");
+	if(ImGui::RadioButton("Atomic", unpackKernel == UnpackKernel::atomic))
+	{
+		unpackKernel = UnpackKernel::atomic;
+		update();
+	}
+	ImGui::SameLine();
+	if(ImGui::RadioButton("Prefix Sum", unpackKernel == UnpackKernel::scan))
+	{
+		unpackKernel = UnpackKernel::scan;
+		update();
+	}
+
+	if(ImGui::Checkbox("Decompression Cache", &decompressionCache))
+		update();
+	if(decompressionCache)
+	{
+		if(ImGui::InputInt("Cache Budget (MiB)", &cacheBudget, 64, 512))
+		{
+			cacheBudget = std::max(cacheBudget, 1);
+			update();
+		}
+		std::size_t cachedCount = totalBrickCount - std::count(bitmapCacheSlots.begin(), bitmapCacheSlots.end(), noSlot);
+		ImGui::Text("Cache Slots: %zu, Cached Bricks: %zu", cacheSlotBitmaps.size(), cachedCount);
+		ImGui::Text("Unpacked This Frame: %zu, Over Budget: %zu", cacheMissCount, cacheOverBudgetCount);
+	}
+
+	if(!decompressionCache)
+	{
+		if(ImGui::Checkbox("Single Dispatch", &singleDispatch))
+			update();
+		if(singleDispatch && !GLAD_GL_ARB_indirect_parameters)
+			ImGui::Text("GL_ARB_indirect_parameters is not supported, unpacking in batches");
+	}
+	if(useSingleDispatch())
+	{
+		if(ImGui::InputInt("Segment Budget (MiB)", &segmentBudget, 64, 256))
+		{
+			segmentBudget = std::max(segmentBudget, 1);
+			update();
+		}
+		ImGui::Text("Segments: %zu, Passes: %zu", segmentCount, segmentPasses.empty() ? 0 : segmentPasses.size() - 1);
+	}
+
+	if(ImGui::Checkbox("Adaptive Encoding", &adaptiveEncoding))
+		update();
+	if(adaptiveEncoding && !useAdaptiveEncoding())
+		ImGui::Text("The atomic kernel only reads dense bitmaps");
+	if(useAdaptiveEncoding())
+		ImGui::Text("Dense: %zu, Sparse: %zu, Morton: %zu", encodingCounts[0], encodingCounts[1], encodingCounts[2]);
+
 	ImGui::SliderInt("Point Size", &pointSize, 1, 16);
-	if(ImGui::InputInt("Batch Size", &batchSize, 1, 10))
+	if(!decompressionCache && !useSingleDispatch() && ImGui::InputInt("Batch Size", &batchSize, 1, 10))
 	{
 		if(batchSize < 1)
 			batchSize = 1;
@@ -312,6 +926,20 @@ void PCRendererBitmap::drawUI()
 	ImGui::SameLine();
 	drawMemoryConsumption(SSBODrawCommands.size());
 
+	if(useSingleDispatch())
+	{
+		ImGui::Text("Memory Segments: ");
+		ImGui::SameLine();
+		drawMemoryConsumption(SSBOSegmentPositions.size() + SSBOSegmentPositionOffsets.size() + SSBOSegmentDrawCommands.size() + SSBOSegmentDrawCounts.size());
+	}
+
+	if(decompressionCache)
+	{
+		ImGui::Text("Memory Cache: ");
+		ImGui::SameLine();
+		drawMemoryConsumption(SSBOCachePositions.size() + SSBOCacheDrawCommands.size() + SSBOCacheRequests.size());
+	}
+
 }
 
 void PCRendererBitmap::reloadShaders()
@@ -321,4 +949,8 @@ void PCRendererBitmap::reloadShaders()
 	unpack16Shader.reload();
 	unpack8Shader.reload();
 	unpack4Shader.reload();
+	unpackScan32Shader.reload();
+	unpackScan16Shader.reload();
+	unpackScan8Shader.reload();
+	unpackScan4Shader.reload();
 }
@@ -0,0 +1,109 @@
+#include "PCRendererBrickExpansion.h"
+#include "Shader.h"
+#include "PointCloud.h"
+#include "Scene.h"
+#include "glm/glm.hpp"
+#include "imgui.h"
+
+namespace
+{
+	Shader basicShader{"shaders/pcBrickExpansion.vert", "shaders/pcBrickGS.frag"};
+	Shader expandShader{"shaders/pcExpandBricks.comp"};
+	int pointSize = 2;
+	bool frustumCulling = true;
+}
+
+PCRendererBrickExpansion::PCRendererBrickExpansion()
+	:PCRenderer(&basicShader)
+{
+}
+
+void PCRendererBrickExpansion::update()
+{
+	//the same streams as the brick indirect and geometry shader renderers
+	auto bricks = cloud->getPackedStream<DrawCommand>({"drawCommands", cloud->getSubdivisions()}, [&]() {
+		std::vector<DrawCommand> bricks;
+		auto brickOffsets = cloud->getBrickOffsets();
+		for(std::size_t brickIndex = 0; brickIndex < cloud->getBrickCount(); brickIndex++)
+		{
+			if(brickOffsets[brickIndex] == brickOffsets[brickIndex + 1])
+				continue;
+			DrawCommand brick{};
+			brick.count = brickOffsets[brickIndex + 1] - brickOffsets[brickIndex];
+			brick.first = brickOffsets[brickIndex];
+			brick.baseInstance = brickIndex;
+			bricks.push_back(brick);
+		}
+		return bricks;
+	}, [&](Span<DrawCommand const> bricks) {
+		return isBrickDrawCommandStream(bricks);
+	});
+	brickCount = bricks.size();
+
+	auto compressedPositions = cloud->getPackedStream<std::uint32_t>({"positionsUnorm4x8", cloud->getSubdivisions(), 32}, [&]() {
+		std::vector<std::uint32_t> compressedPositions;
+		compressedPositions.reserve(cloud->getPositions().size());
+		for(auto const& position : cloud->getPositions())
+			compressedPositions.push_back(glm::packUnorm4x8(glm::vec4(position, 0.0f)));
+		return compressedPositions;
+	}, [&](Span<std::uint32_t const> compressedPositions) {
+		return isPointStream(compressedPositions.size());
+	});
+
+	bindVAO();
+	SSBOBricks.write({{(std::byte const*)bricks.data(), bricks.sizeInBytes()}});
+	SSBOPositions.write({{(std::byte const*)compressedPositions.data(), compressedPositions.sizeInBytes()}});
+	DrawBuffer.reserve(bricks.sizeInBytes());
+}
+
+void PCRendererBrickExpansion::render(Scene const* scene)
+{
+	PCRenderer::render(scene);
+	if(brickCount == 0)
+		return;
+
+	glm::mat4 modelViewProjection = scene->getCamera().getProjectionMatrix() * scene->getCamera().getViewMatrix() * scene->getModelMatrix();
+	expandShader.use();
+	expandShader.set("modelViewProjection", modelViewProjection);
+	expandShader.set("cloudOrigin", cloud->getBounds().first);
+	expandShader.set("brickSize", cloud->getBrickSize());
+	expandShader.set("subdivisions", glm::uvec3(cloud->getSubdivisions()));
+	expandShader.set("brickCount", brickCount);
+	expandShader.set("frustumCulling", frustumCulling);
+	SSBOBricks.bindBase(0);
+	DrawBuffer.bindBase(GL_SHADER_STORAGE_BUFFER, 1);
+	glDispatchCompute((brickCount + 63) / 64, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+	mainShader->use();
+	mainShader->set("cloudOrigin", cloud->getBounds().first);
+	mainShader->set("brickSize", cloud->getBrickSize());
+	mainShader->set("subdivisions", glm::uvec3(cloud->getSubdivisions()));
+	glPointSize(pointSize);
+
+	bindVAO();
+	SSBOPositions.bindBase(2);
+	DrawBuffer.bind();
+	glMultiDrawArraysIndirect(GL_POINTS, nullptr, brickCount, 0);
+}
+
+void PCRendererBrickExpansion::drawUI()
+{
+	PCRenderer::drawUI();
+	ImGui::SliderInt("Point Size", &pointSize, 1, 16);
+	ImGui::Checkbox("Frustum Culling", &frustumCulling);
+
+	ImGui::Text("Memory Positions: ");
+	ImGui::SameLine();
+	drawMemoryConsumption(SSBOPositions.size());
+
+	ImGui::Text("Memory Bricks: ");
+	ImGui::SameLine();
+	drawMemoryConsumption(SSBOBricks.size() + DrawBuffer.size());
+}
+
+void PCRendererBrickExpansion::reloadShaders()
+{
+	basicShader.reload();
+	expandShader.reload();
+}
@@ -17,29 +17,33 @@ PCRendererBrickGS::PCRendererBrickGS()
 
 void PCRendererBrickGS::update()
 {
-	static std::vector<glm::u8vec3> brickIndices;
-	static std::vector<std::uint32_t> bufferOffsets;
-	static std::vector<std::uint32_t> bufferLengths;
-	static std::vector<std::uint32_t> compressedPositions;
-	brickIndices.clear();
-	bufferOffsets.clear();
-	bufferLengths.clear();
+	std::vector<glm::u8vec3> brickIndices;
+	std::vector<std::uint32_t> bufferOffsets;
+	std::vector<std::uint32_t> bufferLengths;
 	bufferOffsets.push_back(0);
-	compressedPositions.clear();
 	brickCount = 0;
-	for(auto brick : cloud->getAllBricks())
+	for(auto const& brick : cloud->getAllBricks())
 	{
 		if(brick.positions.empty())
 			continue;
 		brickCount++;
 		brickIndices.push_back(brick.indices);
-		for(auto const& position : brick.positions)
-			compressedPositions.push_back(glm::packUnorm4x8(glm::vec4(position, 0.0f)));
-
 		bufferOffsets.push_back(bufferOffsets.back() + brick.positions.size());
 		bufferLengths.push_back(brick.positions.size());
 	}
 	bufferOffsets.pop_back();
+
+	//bricks are stored back to back, so the positions stream is one sweep over the cloud
+	auto compressedPositions = cloud->getPackedStream<std::uint32_t>({"positionsUnorm4x8", cloud->getSubdivisions(), 32}, [&]() {
+		std::vector<std::uint32_t> compressedPositions;
+		compressedPositions.reserve(cloud->getPositions().size());
+		for(auto const& position : cloud->getPositions())
+			compressedPositions.push_back(glm::packUnorm4x8(glm::vec4(position, 0.0f)));
+		return compressedPositions;
+	}, [&](Span<std::uint32_t const> compressedPositions) {
+		return isPointStream(compressedPositions.size());
+	});
+
 	std::size_t brickIndicesBufferSize = brickIndices.size() * sizeof(brickIndices.front());
 	std::size_t bufferOffsetsBufferSize = bufferOffsets.size() * sizeof(bufferOffsets.front());
 
@@ -57,7 +61,7 @@ void PCRendererBrickGS::update()
 	glEnableVertexAttribArray(2);//Buffer Lengths
 	glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, 0, (void*)(brickIndicesBufferSize + bufferOffsetsBufferSize));
 
-	SSBO.write({{(std::byte const*)compressedPositions.data(), compressedPositions.size() * sizeof(compressedPositions.front())}});
+	SSBO.write({{(std::byte const*)compressedPositions.data(), compressedPositions.sizeInBytes()}});
 	SSBO.bindBase(0);
 }
 
@@ -2,8 +2,15 @@
 #include "Shader.h"
 #include "PointCloud.h"
 #include "Scene.h"
+#include "NormalEncoding.h"
+#include "ColorEncoding.h"
+#include "Parallel.h"
 #include "imgui.h"
 
+#include <algorithm>
+#include <cstring>
+#include <string>
+
 enum class RenderMode
 {
 	basic,
@@ -11,36 +18,106 @@ enum class RenderMode
 	litColoured
 };
 
+enum class NormalMode
+{
+	spherical,
+	octahedral
+};
+
+enum class CullingMode
+{
+	disabled,
+	frustum,
+	occlusion
+};
+
 namespace
 {
 	Shader basicShader{"shaders/pcBrickIndirect.vert", "shaders/pcBrickIndirect.frag"};
 	Shader litShader{"shaders/pcBrickIndirectLit.vert", "shaders/pcLitDisk.frag", "shaders/pcLitDisk.geom"};
 	Shader litColouredShader{"shaders/pcBrickIndirectLitColored.vert", "shaders/pcLitDiskColored.frag", "shaders/pcLitDiskColored.geom"};
+	Shader cullShader{"shaders/pcCullBricks.comp"};
 	RenderMode renderMode = RenderMode::basic;
 	
 	bool backFaceCulling = true;
 	int pointSize = 2;
 	float diskRadius = 0.0005f;
 	int positionSize = 16;
-	int normalSize = 16;
-	glm::vec2 toSpherical(glm::vec3 n)
+	bool adaptivePrecision = false;
+	float targetError = 1.0f / 2048.0f;//relative to the largest brick extent, so it carries over to other clouds and subdivisions
+	constexpr int maxAdaptiveBits = 16;
+	NormalMode normalMode = NormalMode::octahedral;
+	int normalSize = 16;//spherical, bits per component
+	int octahedralNormalSize = 16;//bits per normal
+	int colorSize = 24;//bits per point, anything below is block compressed
+	bool vertexPulling = true;
+	CullingMode cullingMode = CullingMode::frustum;
+	bool outOfCore = false;
+	int hostBudgetMegaBytes = 2048;
+	int gpuBudgetMegaBytes = 512;
+	int uploadBudgetMegaBytes = 32;
+
+	//bytes per normal in the vertex stream, 24 bit octahedral normals are padded to a whole word
+	std::size_t getNormalStride()
+	{
+		if(normalMode == NormalMode::spherical)
+			return normalSize == 16 ? sizeof(std::uint32_t) : sizeof(std::uint16_t);
+		if(octahedralNormalSize <= 8)
+			return sizeof(std::uint8_t);
+		if(octahedralNormalSize <= 16)
+			return sizeof(std::uint16_t);
+		return sizeof(std::uint32_t);
+	}
+
+	GLenum getNormalType()
+	{
+		switch(getNormalStride())
+		{
+			case sizeof(std::uint8_t):
+				return GL_UNSIGNED_BYTE;
+			case sizeof(std::uint16_t):
+				return GL_UNSIGNED_SHORT;
+			default:
+				return GL_UNSIGNED_INT;
+		}
+	}
+
+	//what the lit shaders call normalSize
+	int getNormalComponentSize()
 	{
-		float thetaNormalized = glm::acos(n.y) / glm::pi<float>();
-		float phiNormalized = (glm::atan(n.x, n.z) / glm::pi<float>()) * 0.5 + 0.5;
-		return glm::vec2(phiNormalized, thetaNormalized);
+		return normalMode == NormalMode::spherical ? normalSize : octahedralNormalSize / 2;
 	}
 
-	std::uint32_t toSpherical16(glm::vec3 n)
+	//the quantization grid of a brick, spans only its points, same layout as in the brick indirect shaders
+	struct AdaptiveBrick
 	{
-		return glm::packUnorm2x16(toSpherical(n));
+		glm::vec3 minimum{0.0f};//brick local, like the positions
+		std::uint32_t firstPoint = 0;
+		glm::vec3 extent{0.0f};
+		std::uint32_t bits = 0;//per axis, x in the lowest five bits
+		std::uint32_t dataOffset = 0;//in words
+		std::uint32_t padding[3]{};
+	};
+
+	std::uint32_t getAdaptiveWidth(AdaptiveBrick const& brick)
+	{
+		return (brick.bits & 31u) + (brick.bits >> 5 & 31u) + (brick.bits >> 10 & 31u);
+	}
+
+	//the shaders read whole words when they pull the vertices, so 8, 16 and 24 bit streams are padded
+	void writeStream(GPUBuffer& buffer, std::byte const* data, std::size_t size)
+	{
+		std::uint32_t padding = 0;
+		if(size % sizeof(padding) == 0)
+			buffer.write({{data, size}});
+		else
+			buffer.write({{data, size}, {(std::byte const*)&padding, sizeof(padding) - size % sizeof(padding)}});
 	}
 
-	std::uint16_t toSpherical8(glm::vec3 n)
+	//the interpolation index of a colour block takes all but one bit per point, the endpoints the last one
+	int getColorIndexBits()
 	{
-		glm::vec2 s = toSpherical(n);
-		std::uint16_t packed = 256 * s.x;
-		packed |= std::uint16_t(256 * s.y) << 8;
-		return packed;
+		return colorSize == 24 ? 0 : colorSize - 1;
 	}
 }
 
@@ -59,117 +136,503 @@ bool PCRendererBrickIndirect::needColors() const
 	return renderMode == RenderMode::litColoured;
 }
 
-void PCRendererBrickIndirect::updatePositions32()
+//without colours in the cloud the coloured mode falls back to the lit shader
+bool PCRendererBrickIndirect::drawsColors() const
 {
-	static std::vector<DrawCommand> indirectDraws;
-	static std::vector<std::uint32_t> compressedPositions;
-
-	int brickIndex = -1;
-	for(auto brick : cloud->getAllBricks())
-	{
-		brickIndex++;
-		if(brick.positions.empty())
-			continue;
-		DrawCommand brickDrawCommand{};
-		brickDrawCommand.count = brick.positions.size();
-		brickDrawCommand.first = compressedPositions.size();
-		brickDrawCommand.baseInstance = brickIndex;
-		indirectDraws.push_back(std::move(brickDrawCommand));
-		for(auto const& position : brick.positions)
-			compressedPositions.push_back(packPosition1024(position));
-	}
+	return needColors() && cloud && cloud->hasColors();
+}
+
+//records key as the stream's contents, true if it held anything else before
+bool PCRendererBrickIndirect::needsUpload(Stream stream, PackedStreamKey const& key)
+{
+	if(uploadedStreams[stream] == key)
+		return false;
+	uploadedStreams[stream] = key;
+	return true;
+}
+
+void PCRendererBrickIndirect::updateDrawCommands()
+{
+	//offsets into the positions stream are the same for every position size
+	PackedStreamKey key{"drawCommands", cloud->getSubdivisions()};
+	if(!needsUpload(drawCommandStream, key))
+		return;
+	auto indirectDraws = cloud->getPackedStream<DrawCommand>(key, [&]() {
+		std::vector<DrawCommand> indirectDraws;
+		indirectDraws.reserve(cloud->getBrickCount());
+		unsigned int first = 0;
+		int brickIndex = -1;
+		for(auto const& brick : cloud->getAllBricks())
+		{
+			brickIndex++;
+			if(brick.positions.empty())
+				continue;
+			DrawCommand brickDrawCommand{};
+			brickDrawCommand.count = brick.positions.size();
+			brickDrawCommand.first = first;
+			brickDrawCommand.baseInstance = brickIndex;
+			indirectDraws.push_back(std::move(brickDrawCommand));
+			first += brick.positions.size();
+		}
+		return indirectDraws;
+	}, [&](Span<DrawCommand const> indirectDraws) {
+		return isBrickDrawCommandStream(indirectDraws);
+	});
 	indirectDrawCount = indirectDraws.size();
 
 	bindVAO();
-	DrawBuffer.write({{(std::byte const*)indirectDraws.data(), indirectDraws.size() * sizeof(indirectDraws.front())}});
+	DrawBuffer.write({{(std::byte const*)indirectDraws.data(), indirectDraws.sizeInBytes()}});
 	DrawBuffer.bind();
-	VBOPositions.write({{(std::byte const*)compressedPositions.data(), compressedPositions.size() * sizeof(compressedPositions.front())}});
+	VisibleDrawBuffer.reserve(2 * indirectDraws.sizeInBytes());
+	VisibleDrawCount.reserve(cullingStatistics.size() * sizeof(GLuint));
+	VisibleDrawCount.clear();
+	//written as well, the regions are zeroed here so the first frames read no garbage
+	CullingStatisticsReadback.reserveStreaming(sizeof(cullingStatistics), 3, GL_MAP_READ_BIT | GL_MAP_WRITE_BIT);
+	std::memset(CullingStatisticsReadback.map(0), 0, CullingStatisticsReadback.size());
+	//nothing counts as visible at first, so the first frame draws everything in the second pass
+	SSBOBrickVisibility.reserve(indirectDrawCount * sizeof(GLuint));
+	SSBOBrickVisibility.clear();
+	cullingStatistics.fill(0);
+}
+
+void PCRendererBrickIndirect::updatePositions32()
+{
+	PackedStreamKey key{"positions", cloud->getSubdivisions(), 32};
+	bindVAO();
+	if(needsUpload(positionStream, key))
+	{
+		auto compressedPositions = cloud->getPackedStream<std::uint32_t>(key, [&]() {
+			std::vector<std::uint32_t> compressedPositions;
+			compressedPositions.reserve(cloud->getPositions().size());
+			for(auto const& position : cloud->getPositions())
+				compressedPositions.push_back(packPosition1024(position));
+			return compressedPositions;
+		}, [&](Span<std::uint32_t const> compressedPositions) {
+			return isPointStream(compressedPositions.size());
+		});
+		VBOPositions.write({{(std::byte const*)compressedPositions.data(), compressedPositions.sizeInBytes()}});
+	}
 	VBOPositions.bind();
 	glEnableVertexAttribArray(0);//Compressed Positions
 	glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, 0, (void*)(0));
-
-	compressedPositions.clear();
-	indirectDraws.clear();
 }
 
 void PCRendererBrickIndirect::updatePositions16()
 {
-	static std::vector<DrawCommand> indirectDraws;
-	static std::vector<std::uint16_t> compressedPositions;
-
-	int brickIndex = -1;
-	for(auto brick : cloud->getAllBricks())
-	{
-		brickIndex++;
-		if(brick.positions.empty())
-			continue;
-		DrawCommand brickDrawCommand{};
-		brickDrawCommand.count = brick.positions.size();
-		brickDrawCommand.first = compressedPositions.size();
-		brickDrawCommand.baseInstance = brickIndex;
-		indirectDraws.push_back(std::move(brickDrawCommand));
-		for(auto const& position : brick.positions)
-			compressedPositions.push_back(packPosition32(position));
-	}
-	indirectDrawCount = indirectDraws.size();
-
+	PackedStreamKey key{"positions", cloud->getSubdivisions(), 16};
 	bindVAO();
-	DrawBuffer.write({{(std::byte const*)indirectDraws.data(), indirectDraws.size() * sizeof(indirectDraws.front())}});
-	DrawBuffer.bind();
-	VBOPositions.write({{(std::byte const*)compressedPositions.data(), compressedPositions.size() * sizeof(compressedPositions.front())}});
+	if(needsUpload(positionStream, key))
+	{
+		auto compressedPositions = cloud->getPackedStream<std::uint16_t>(key, [&]() {
+			std::vector<std::uint16_t> compressedPositions;
+			compressedPositions.reserve(cloud->getPositions().size());
+			for(auto const& position : cloud->getPositions())
+				compressedPositions.push_back(packPosition32(position));
+			return compressedPositions;
+		}, [&](Span<std::uint16_t const> compressedPositions) {
+			return isPointStream(compressedPositions.size());
+		});
+		writeStream(VBOPositions, (std::byte const*)compressedPositions.data(), compressedPositions.sizeInBytes());
+	}
 	VBOPositions.bind();
 	glEnableVertexAttribArray(0);//Compressed Positions
 	glVertexAttribIPointer(0, 1, GL_UNSIGNED_SHORT, 0, (void*)(0));
-
-	compressedPositions.clear();
-	indirectDraws.clear();
 }
 
+void PCRendererBrickIndirect::updatePositionsAdaptive()
+{
+	glm::vec3 brickSize = cloud->getBrickSize();
+	float worldError = targetError * std::max({brickSize.x, brickSize.y, brickSize.z});
+	//the subdivisions in the keys tell the brick sizes apart
+	PackedStreamKey key{"adaptivePositions", cloud->getSubdivisions()};
+	std::memcpy(&key.errorBits, &targetError, sizeof(targetError));
+	PackedStreamKey bricksKey = key;
+	bricksKey.name = "adaptiveBricks";
+	bindVAO();
+	//the shaders read the positions by brick and vertex id
+	glDisableVertexAttribArray(0);
+	if(!needsUpload(positionStream, key))
+		return;
+
+	//every axis gets just enough bits for the cell centres to stay within the target error of the points
+	auto adaptiveBricks = cloud->getPackedStream<AdaptiveBrick>(bricksKey, [&]() {
+		std::vector<AdaptiveBrick> adaptiveBricks(cloud->getBrickCount());
+		auto brickOffsets = cloud->getBrickOffsets();
+		parallelFor(getWorkerCount(), adaptiveBricks.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+			for(std::size_t brickIndex = begin; brickIndex < end; brickIndex++)
+			{
+				auto positions = cloud->getBrickAt(brickIndex).positions;
+				if(positions.empty())
+					continue;
+				glm::vec3 lowest = positions[0];
+				glm::vec3 highest = positions[0];
+				for(glm::vec3 position : positions)
+				{
+					lowest = glm::min(lowest, position);
+					highest = glm::max(highest, position);
+				}
+				AdaptiveBrick& brick = adaptiveBricks[brickIndex];
+				brick.minimum = lowest;
+				brick.extent = highest - lowest;
+				brick.firstPoint = static_cast<std::uint32_t>(brickOffsets[brickIndex]);
+				for(int axis = 0; axis < 3; axis++)
+				{
+					float worldExtent = brick.extent[axis] * brickSize[axis];
+					std::uint32_t bits = 0;
+					while(bits < maxAdaptiveBits && worldExtent / float(2u << bits) > worldError)
+						bits++;
+					brick.bits |= bits << (5 * axis);
+				}
+			}
+		});
+		std::uint32_t dataOffset = 0;
+		for(std::size_t brickIndex = 0; brickIndex < adaptiveBricks.size(); brickIndex++)
+		{
+			std::size_t pointCount = brickOffsets[brickIndex + 1] - brickOffsets[brickIndex];
+			adaptiveBricks[brickIndex].dataOffset = dataOffset;
+			dataOffset += static_cast<std::uint32_t>((pointCount * getAdaptiveWidth(adaptiveBricks[brickIndex]) + 31) / 32);
+		}
+		return adaptiveBricks;
+	}, [&](Span<AdaptiveBrick const> adaptiveBricks) {
+		//the shaders find every point's bits through firstPoint and dataOffset
+		auto brickOffsets = cloud->getBrickOffsets();
+		if(adaptiveBricks.size() != cloud->getBrickCount())
+			return false;
+		std::uint64_t dataOffset = 0;
+		for(std::size_t brickIndex = 0; brickIndex < adaptiveBricks.size(); brickIndex++)
+		{
+			AdaptiveBrick const& brick = adaptiveBricks[brickIndex];
+			bool validBits = (brick.bits & 31u) <= maxAdaptiveBits && (brick.bits >> 5 & 31u) <= maxAdaptiveBits && (brick.bits >> 10 & 31u) <= maxAdaptiveBits;
+			if(!validBits || brick.firstPoint != brickOffsets[brickIndex] || brick.dataOffset != dataOffset)
+				return false;
+			dataOffset += ((brickOffsets[brickIndex + 1] - brickOffsets[brickIndex]) * getAdaptiveWidth(brick) + 31) / 32;
+		}
+		return true;
+	});
+
+	//every brick starts on a whole word, so the bricks are packed independently
+	auto compressedPositions = cloud->getPackedStream<std::uint32_t>(key, [&]() {
+		auto brickOffsets = cloud->getBrickOffsets();
+		AdaptiveBrick const& lastBrick = adaptiveBricks[adaptiveBricks.size() - 1];
+		std::size_t lastPointCount = brickOffsets[adaptiveBricks.size()] - brickOffsets[adaptiveBricks.size() - 1];
+		std::vector<std::uint32_t> compressedPositions(lastBrick.dataOffset + (lastPointCount * getAdaptiveWidth(lastBrick) + 31) / 32);
+		parallelFor(getWorkerCount(), adaptiveBricks.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+			for(std::size_t brickIndex = begin; brickIndex < end; brickIndex++)
+			{
+				AdaptiveBrick const& brick = adaptiveBricks[brickIndex];
+				glm::uvec3 bits = glm::uvec3(brick.bits, brick.bits >> 5, brick.bits >> 10) & 31u;
+				glm::vec3 cellCounts = glm::vec3(glm::uvec3(1u) << bits);
+				glm::vec3 scale = cellCounts / glm::max(brick.extent, glm::vec3(1e-20f));
+				std::uint32_t* data = compressedPositions.data() + brick.dataOffset;
+				std::uint64_t pending = 0;
+				std::uint32_t pendingBits = 0;
+				for(glm::vec3 position : cloud->getBrickAt(brickIndex).positions)
+				{
+					glm::uvec3 cell = glm::min((position - brick.minimum) * scale, cellCounts - 1.0f);
+					for(int axis = 0; axis < 3; axis++)
+					{
+						pending |= std::uint64_t(cell[axis]) << pendingBits;
+						pendingBits += bits[axis];
+						if(pendingBits >= 32)
+						{
+							*data++ = static_cast<std::uint32_t>(pending);
+							pending >>= 32;
+							pendingBits -= 32;
+						}
+					}
+				}
+				if(pendingBits > 0)
+					*data = static_cast<std::uint32_t>(pending);
+			}
+		});
+		return compressedPositions;
+	}, [&](Span<std::uint32_t const> compressedPositions) {
+		auto brickOffsets = cloud->getBrickOffsets();
+		AdaptiveBrick const& lastBrick = adaptiveBricks[adaptiveBricks.size() - 1];
+		std::size_t lastPointCount = brickOffsets[adaptiveBricks.size()] - brickOffsets[adaptiveBricks.size() - 1];
+		return compressedPositions.size() == lastBrick.dataOffset + (lastPointCount * getAdaptiveWidth(lastBrick) + 31) / 32;
+	});
+	adaptiveBitsPerPoint = 8.0f * compressedPositions.sizeInBytes() / std::max<std::size_t>(cloud->getPositions().size(), 1);
+	SSBOAdaptiveBricks.write({{(std::byte const*)adaptiveBricks.data(), adaptiveBricks.sizeInBytes()}});
+	VBOPositions.write({{(std::byte const*)compressedPositions.data(), compressedPositions.sizeInBytes()}});
+}
 
 void PCRendererBrickIndirect::updateNormals16()
 {
-	static std::vector<std::uint32_t> normals;
-
-	for(auto const& brick : cloud->getAllBricks())
+	//empty bricks hold no normals, so the brick sorted normals map one to one onto the positions stream
+	PackedStreamKey key{"normals", cloud->getSubdivisions(), 0, 16};
+	if(needsUpload(normalStream, key))
 	{
-		if(brick.positions.empty())
-			continue;
-		for(glm::vec3 normal : brick.normals)
-		{
-			normals.push_back(toSpherical16(normal));
-		}
+		auto normals = cloud->getPackedStream<std::uint32_t>(key, [&]() {
+			std::vector<std::uint32_t> normals;
+			normals.reserve(cloud->getNormals().size());
+			for(glm::vec3 normal : cloud->getNormals())
+				normals.push_back(toSpherical16(normal));
+			return normals;
+		}, [&](Span<std::uint32_t const> normals) {
+			return isPointStream(normals.size());
+		});
+		VBONormals.write({{(std::byte const*)normals.data(), normals.sizeInBytes()}});
 	}
-
-	VBONormals.write({{(std::byte const*)normals.data(), normals.size() * sizeof(normals.front())}});
 	VBONormals.bind();
 
 	glEnableVertexAttribArray(1);//Normals
 	glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, 0, (void*)(0));
-
-	normals.clear();
 }
 
 void PCRendererBrickIndirect::updateNormals8()
 {
-	static std::vector<std::uint16_t> normals;
+	//empty bricks hold no normals, so the brick sorted normals map one to one onto the positions stream
+	PackedStreamKey key{"normals", cloud->getSubdivisions(), 0, 8};
+	if(needsUpload(normalStream, key))
+	{
+		auto normals = cloud->getPackedStream<std::uint16_t>(key, [&]() {
+			std::vector<std::uint16_t> normals;
+			normals.reserve(cloud->getNormals().size());
+			for(glm::vec3 normal : cloud->getNormals())
+				normals.push_back(toSpherical8(normal));
+			return normals;
+		}, [&](Span<std::uint16_t const> normals) {
+			return isPointStream(normals.size());
+		});
+		writeStream(VBONormals, (std::byte const*)normals.data(), normals.sizeInBytes());
+	}
+	VBONormals.bind();
 
-	for(auto const& brick : cloud->getAllBricks())
+	glEnableVertexAttribArray(1);//Normals
+	glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, 0, (void*)(0));
+}
+
+void PCRendererBrickIndirect::updateNormalsOctahedral()
+{
+	//empty bricks hold no normals, so the brick sorted normals map one to one onto the positions stream
+	PackedStreamKey key{"octahedralNormals", cloud->getSubdivisions(), 0, octahedralNormalSize};
+	if(needsUpload(normalStream, key))
 	{
-		if(brick.positions.empty())
-			continue;
-		for(glm::vec3 normal : brick.normals)
+		int componentSize = getNormalComponentSize();
+		auto isNormalStream = [&](auto normals) { return isPointStream(normals.size()); };
+		std::pair<std::byte const*, std::size_t> normals;
+		switch(getNormalStride())
 		{
-			normals.push_back(toSpherical8(normal));
+			case sizeof(std::uint8_t):
+			{
+				auto packed = cloud->getPackedStream<std::uint8_t>(key, [&]() { return toOctahedral<std::uint8_t>(cloud->getNormals(), componentSize); }, isNormalStream);
+				normals = {(std::byte const*)packed.data(), packed.sizeInBytes()};
+				break;
+			}
+			case sizeof(std::uint16_t):
+			{
+				auto packed = cloud->getPackedStream<std::uint16_t>(key, [&]() { return toOctahedral<std::uint16_t>(cloud->getNormals(), componentSize); }, isNormalStream);
+				normals = {(std::byte const*)packed.data(), packed.sizeInBytes()};
+				break;
+			}
+			default:
+			{
+				auto packed = cloud->getPackedStream<std::uint32_t>(key, [&]() { return toOctahedral<std::uint32_t>(cloud->getNormals(), componentSize); }, isNormalStream);
+				normals = {(std::byte const*)packed.data(), packed.sizeInBytes()};
+				break;
+			}
 		}
-	}
 
-	VBONormals.write({{(std::byte const*)normals.data(), normals.size() * sizeof(normals.front())}});
+		writeStream(VBONormals, normals.first, normals.second);
+	}
 	VBONormals.bind();
 
 	glEnableVertexAttribArray(1);//Normals
-	glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, 0, (void*)(0));
+	glVertexAttribIPointer(1, 1, getNormalType(), 0, (void*)(0));
+}
+
+void PCRendererBrickIndirect::updateColors()
+{
+	if(colorSize == 24)
+	{
+		//not a packed stream, the key only tells the raw colours apart from the blocks
+		if(needsUpload(colorStream, {"colors", cloud->getSubdivisions()}))
+			writeStream(VBOColors, (std::byte const*)cloud->getColors().data(), cloud->getColors().sizeInBytes());
+		VBOColors.bind();
+
+		glEnableVertexAttribArray(2);//Colors
+		glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, true, 0, (void*)(0));
+		colorPSNR = 0.0f;
+		return;
+	}
+
+	//the blocks run over the brick sorted stream, so a draw's gl_VertexID finds its point's block directly
+	int indexBits = getColorIndexBits();
+	PackedStreamKey key{"colorBlocks" + std::to_string(indexBits), cloud->getSubdivisions()};
+	glDisableVertexAttribArray(2);
+	if(!needsUpload(colorStream, key))
+		return;
+	auto blocks = cloud->getPackedStream<std::uint32_t>(key, [&]() {
+		return toColorBlocks(cloud->getColors(), indexBits);
+	}, [&](Span<std::uint32_t const> blocks) {
+		return blocks.size() == (cloud->getColors().size() + colorBlockSize - 1) / colorBlockSize * getColorBlockWords(indexBits);
+	});
+	colorPSNR = getColorPSNR(cloud->getColors(), blocks, indexBits);
+	VBOColors.write({{(std::byte const*)blocks.data(), blocks.sizeInBytes()}});
+}
+
+void PCRendererBrickIndirect::updateOutOfCore()
+{
+	VBOPositions.free();
+	VBONormals.free();
+	VBOColors.free();
+	SSBOAdaptiveBricks.free();
+	DrawBuffer.free();
+	VisibleDrawBuffer.free();
+	VisibleDrawCount.free();
+	CullingStatisticsReadback.free();
+	SSBOBrickVisibility.free();
+	uploadedStreams.fill(std::nullopt);
+	residency.reset();
+
+	BrickResidency::StreamLayout layout{};
+	layout[0] = positionSize == 32 ? sizeof(std::uint32_t) : sizeof(std::uint16_t);
+	if(needNormals())
+		layout[1] = getNormalStride();
+	if(drawsColors())
+		layout[2] = sizeof(glm::u8vec3);
+
+	//runs on the loader threads, so it only captures the settings by value
+	auto packer = [positionSize = positionSize, normalMode = normalMode, normalSize = normalSize, octahedralComponentSize = octahedralNormalSize / 2, layout](PointCloudBrick const& brick) {
+		BrickResidency::BrickPayload payload;
+		auto append = [](std::vector<std::byte>& stream, auto value) {
+			std::byte const* bytes = reinterpret_cast<std::byte const*>(&value);
+			stream.insert(stream.end(), bytes, bytes + sizeof(value));
+		};
+		payload[0].reserve(brick.positions.size() * layout[0]);
+		for(auto const& position : brick.positions)
+		{
+			if(positionSize == 32)
+				append(payload[0], packPosition1024(position));
+			else
+				append(payload[0], packPosition32(position));
+		}
+		if(layout[1] != 0)
+		{
+			payload[1].reserve(brick.normals.size() * layout[1]);
+			for(auto const& normal : brick.normals)
+			{
+				if(normalMode == NormalMode::octahedral)
+				{
+					//the low bytes of the word, like the in core stream
+					std::uint32_t packed = toOctahedral(normal, octahedralComponentSize);
+					std::byte const* bytes = reinterpret_cast<std::byte const*>(&packed);
+					payload[1].insert(payload[1].end(), bytes, bytes + layout[1]);
+				}
+				else if(normalSize == 16)
+					append(payload[1], toSpherical16(normal));
+				else
+					append(payload[1], toSpherical8(normal));
+			}
+		}
+		if(layout[2] != 0)
+		{
+			std::byte const* colors = reinterpret_cast<std::byte const*>(brick.colors.data());
+			payload[2].assign(colors, colors + brick.colors.sizeInBytes());
+		}
+		return payload;
+	};
+
+	BrickResidency::Budgets budgets;
+	budgets.hostBytes = std::size_t(hostBudgetMegaBytes) << 20;
+	budgets.gpuBytes = std::size_t(gpuBudgetMegaBytes) << 20;
+	budgets.uploadBytesPerFrame = std::size_t(uploadBudgetMegaBytes) << 20;
+	residency = std::make_unique<BrickResidency>(cloud, layout, std::move(packer), budgets);
+
+	bindVAO();
+	residency->getStream(0).bind();
+	glEnableVertexAttribArray(0);//Compressed Positions
+	glVertexAttribIPointer(0, 1, positionSize == 32 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, 0, (void*)(0));
+	if(layout[1] != 0)
+	{
+		residency->getStream(1).bind();
+		glEnableVertexAttribArray(1);//Normals
+		glVertexAttribIPointer(1, 1, getNormalType(), 0, (void*)(0));
+	}
+	else
+		glDisableVertexAttribArray(1);
+	if(layout[2] != 0)
+	{
+		residency->getStream(2).bind();
+		glEnableVertexAttribArray(2);//Colors
+		glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, true, 0, (void*)(0));
+	}
+	else
+		glDisableVertexAttribArray(2);
+
+	mainShader->use();
+	mainShader->set("positionSize", positionSize);
+	//pages are packed at the fixed position size
+	mainShader->set("adaptivePrecision", false);
+	if(needNormals())
+	{
+		mainShader->set("normalEncoding", static_cast<int>(normalMode));
+		mainShader->set("normalSize", getNormalComponentSize());
+		mainShader->set("normalStride", static_cast<int>(8 * getNormalStride()));
+	}
+	//pages keep the raw colours, blocks of consecutive points would not survive the paging
+	if(drawsColors())
+		mainShader->set("colorIndexBits", 0);
+	updateVertexPulling({&residency->getStream(0), &residency->getStream(1), &residency->getStream(2)});
+}
+
+//the attributes stay set up, so streams too large for a storage block still draw through them
+void PCRendererBrickIndirect::updateVertexPulling(std::initializer_list<GPUBuffer const*> streams)
+{
+	pullingVertices = vertexPulling;
+	for(GPUBuffer const* stream : streams)
+		pullingVertices = pullingVertices && (!stream || stream->size() <= getMaxShaderStorageBlockSize());
+	bindVAO();
+	if(pullingVertices)
+	{
+		glDisableVertexAttribArray(0);
+		glDisableVertexAttribArray(1);
+		glDisableVertexAttribArray(2);
+	}
+	mainShader->set("vertexPulling", pullingVertices);
+}
+
+//compacts the draw commands of the bricks that pass, the draw count stays on the GPU
+void PCRendererBrickIndirect::cullBricks(Scene const* scene, unsigned int cullPass)
+{
+	glm::mat4 modelViewProjection = scene->getCamera().getProjectionMatrix() * scene->getCamera().getViewMatrix() * scene->getModelMatrix();
+
+	cullShader.use();
+	cullShader.set("modelViewProjection", modelViewProjection);
+	cullShader.set("cloudOrigin", cloud->getBounds().first);
+	cullShader.set("brickSize", cloud->getBrickSize());
+	cullShader.set("subdivisions", glm::uvec3(cloud->getSubdivisions()));
+	cullShader.set("drawCount", static_cast<unsigned int>(indirectDrawCount));
+	cullShader.set("cullPass", cullPass);
+	cullShader.set("depthPyramid", 0);
+	DrawBuffer.bindBase(GL_SHADER_STORAGE_BUFFER, 0);
+	VisibleDrawBuffer.bindBase(GL_SHADER_STORAGE_BUFFER, 1);
+	SSBOBrickVisibility.bindBase(2);
+	VisibleDrawCount.bindBase(0);
+	depthPyramid.bind(0);
+	glDispatchCompute((indirectDrawCount + 63) / 64, 1, 1);
+	//the counters are also cleared and copied by buffer commands
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	mainShader->use();
+}
+
+//the region entered last was fenced when the counters of a few frames ago were copied into it,
+//so it is read before this frame's counters replace it
+void PCRendererBrickIndirect::readCullingStatistics()
+{
+	std::size_t offset = *CullingStatisticsReadback.allocate(sizeof(cullingStatistics));
+	std::memcpy(cullingStatistics.data(), CullingStatisticsReadback.map(offset), sizeof(cullingStatistics));
+	CullingStatisticsReadback.copy(VisibleDrawCount, 0, offset, sizeof(cullingStatistics));
+	CullingStatisticsReadback.advanceRegion();
+}
 
-	normals.clear();
+void PCRendererBrickIndirect::drawVisibleBricks(std::size_t pass) const
+{
+	bindVAO();
+	VisibleDrawBuffer.bind();
+	VisibleDrawCount.bind(GL_PARAMETER_BUFFER_ARB);
+	glMultiDrawArraysIndirectCountARB(GL_POINTS, (void*)(pass * indirectDrawCount * sizeof(DrawCommand)), pass * sizeof(GLuint), indirectDrawCount, 0);
 }
 
 void PCRendererBrickIndirect::update()
@@ -183,62 +646,73 @@ void PCRendererBrickIndirect::update()
 			mainShader = &litShader;
 			break;
 		case RenderMode::litColoured:
-			mainShader = &litColouredShader;
+			mainShader = drawsColors() ? &litColouredShader : &litShader;
 			break;
 	}
 
-	if(positionSize == 32)
+	//the whole cloud is never touched at once, bricks are paged in while rendering
+	if(outOfCore)
 	{
+		updateOutOfCore();
+		return;
+	}
+	residency.reset();
+
+	//the keys only name data of one cloud
+	if(uploadedCloud != cloud)
+	{
+		uploadedStreams.fill(std::nullopt);
+		uploadedCloud = cloud;
+	}
+	updateDrawCommands();
+	if(adaptivePrecision)
+	{
+		updatePositionsAdaptive();
+		cloud->setBrickPrecision(1024);
+	}
+	else if(positionSize == 32)
+	{
+		SSBOAdaptiveBricks.free();
 		updatePositions32();
 		cloud->setBrickPrecision(1024);
 	}
 	else
 	{
+		SSBOAdaptiveBricks.free();
 		updatePositions16();
 		cloud->setBrickPrecision(32);
 	}
 	mainShader->use();
 	mainShader->set("positionSize", positionSize);
+	mainShader->set("adaptivePrecision", adaptivePrecision);
 	
 	if(needNormals())
 	{
-		if(normalSize == 16)
+		if(normalMode == NormalMode::octahedral)
+			updateNormalsOctahedral();
+		else if(normalSize == 16)
 			updateNormals16();
 		else
 			updateNormals8();
 
-		mainShader->set("normalSize", normalSize);
+		mainShader->set("normalEncoding", static_cast<int>(normalMode));
+		mainShader->set("normalSize", getNormalComponentSize());
+		mainShader->set("normalStride", static_cast<int>(8 * getNormalStride()));
 	}
 	else
 	{
-		VBONormals.free();
+		//unused streams are kept, so switching back to a render mode that needs them costs no upload
 		glDisableVertexAttribArray(1);
 	}
 
-	if(needColors())
+	if(drawsColors())
 	{
-		static std::vector<glm::u8vec3> colors;
-
-		for(auto const& brick : cloud->getAllBricks())
-		{
-			if(brick.positions.empty())
-				continue;
-			for(glm::u8vec3 color : brick.colors)
-				colors.push_back(color);
-		}
-
-		VBOColors.write({{(std::byte const*)colors.data(), colors.size() * sizeof(colors.front())}});
-		VBOColors.bind();
-
-		glEnableVertexAttribArray(2);//Colors
-		glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, true, 0, (void*)(0));
-		colors.clear();
+		updateColors();
+		mainShader->set("colorIndexBits", getColorIndexBits());
 	}
 	else
-	{
-		VBOColors.free();
 		glDisableVertexAttribArray(2);
-	}
+	updateVertexPulling({&VBOPositions, needNormals() ? &VBONormals : nullptr, drawsColors() ? &VBOColors : nullptr});
 }
 
 void PCRendererBrickIndirect::render(Scene const* scene)
@@ -263,6 +737,52 @@ void PCRendererBrickIndirect::render(Scene const* scene)
 	glPointSize(pointSize);
 
 	bindVAO();
+	if(residency)
+	{
+		glm::mat4 modelView = scene->getCamera().getViewMatrix() * scene->getModelMatrix();
+		glm::vec3 cameraPosition = glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		residency->update(scene->getCamera().getProjectionMatrix() * modelView, cameraPosition);
+		if(pullingVertices)
+		{
+			residency->getStream(0).bindBase(GL_SHADER_STORAGE_BUFFER, 5);
+			if(needNormals())
+				residency->getStream(1).bindBase(GL_SHADER_STORAGE_BUFFER, 6);
+			if(drawsColors())
+				residency->getStream(2).bindBase(GL_SHADER_STORAGE_BUFFER, 3);
+		}
+		residency->getDrawBuffer().bind();
+		glMultiDrawArraysIndirect(GL_POINTS, (void*)residency->getDrawOffset(), residency->getDrawCount(), 0);
+		return;
+	}
+	if(drawsColors() && (getColorIndexBits() != 0 || pullingVertices))
+		VBOColors.bindBase(GL_SHADER_STORAGE_BUFFER, 3);
+	if(adaptivePrecision)
+		SSBOAdaptiveBricks.bindBase(4);
+	if(adaptivePrecision || pullingVertices)
+		VBOPositions.bindBase(GL_SHADER_STORAGE_BUFFER, 5);
+	if(needNormals() && pullingVertices)
+		VBONormals.bindBase(GL_SHADER_STORAGE_BUFFER, 6);
+	//the counts are read straight from the buffer the culling passes wrote, so drawing never waits for a read back
+	if(cullingMode != CullingMode::disabled && GLAD_GL_ARB_indirect_parameters && indirectDrawCount != 0)
+	{
+		VisibleDrawCount.clear();
+		if(cullingMode == CullingMode::frustum)
+		{
+			cullBricks(scene, 0);
+			drawVisibleBricks(0);
+		}
+		else
+		{
+			//bricks visible last frame are drawn first, whatever they hide is skipped by the second pass
+			cullBricks(scene, 1);
+			drawVisibleBricks(0);
+			depthPyramid.build();
+			cullBricks(scene, 2);
+			drawVisibleBricks(1);
+		}
+		readCullingStatistics();
+		return;
+	}
 	DrawBuffer.bind();
 	glMultiDrawArraysIndirect(GL_POINTS, nullptr, indirectDrawCount, 0);
 
@@ -272,18 +792,47 @@ void PCRendererBrickIndirect::drawUI()
 {
 	PCRenderer::drawUI();
 	ImGui::SliderInt("Point Size", &pointSize, 1, 16);
+	if(ImGui::Checkbox("Vertex Pulling", &vertexPulling))
+		update();
+	if(vertexPulling && cloud && !pullingVertices)
+		ImGui::Text("A stream exceeds the largest storage block, using vertex attributes");
 	ImGui::Text("Position Size");
-	if(ImGui::RadioButton("32", positionSize == 32))
+	if(ImGui::RadioButton("32", positionSize == 32 && !adaptivePrecision))
 	{
 		positionSize = 32;
+		adaptivePrecision = false;
 		update();
 	}
 	ImGui::SameLine();
-	if(ImGui::RadioButton("16", positionSize == 16))
+	if(ImGui::RadioButton("16", positionSize == 16 && !adaptivePrecision))
 	{
 		positionSize = 16;
+		adaptivePrecision = false;
+		update();
+	}
+	ImGui::SameLine();
+	if(ImGui::RadioButton("Adaptive", adaptivePrecision))
+	{
+		adaptivePrecision = true;
 		update();
 	}
+	if(adaptivePrecision)
+	{
+		if(ImGui::InputFloat("Target Error (brick sizes)", &targetError, 0.0f, 0.0f, "%g", ImGuiInputTextFlags_EnterReturnsTrue))
+		{
+			targetError = std::max(targetError, 1e-9f);
+			update();
+		}
+		if(cloud)
+		{
+			glm::vec3 brickSize = cloud->getBrickSize();
+			ImGui::Text("World Space Error: %g", targetError * std::max({brickSize.x, brickSize.y, brickSize.z}));
+		}
+		if(outOfCore)
+			ImGui::Text("Out of core bricks use the %d bit positions", positionSize);
+		else
+			ImGui::Text("Bits Per Point: %.2f", adaptiveBitsPerPoint);
+	}
 
 	ImGui::Text("Render Mode");
 
@@ -312,33 +861,132 @@ void PCRendererBrickIndirect::drawUI()
 	}
 	else if(needNormals())
 	{
-		ImGui::Text("Normal Size");
-		ImGui::PushID("NormalSize");
-		if(ImGui::RadioButton("16", normalSize == 16))
+		ImGui::Text("Normal Encoding");
+		if(ImGui::RadioButton("Spherical", normalMode == NormalMode::spherical))
 		{
-			normalSize = 16;
+			normalMode = NormalMode::spherical;
 			update();
 		}
 		ImGui::SameLine();
-		if(ImGui::RadioButton("8", normalSize == 8))
+		if(ImGui::RadioButton("Octahedral", normalMode == NormalMode::octahedral))
 		{
-			normalSize = 8;
+			normalMode = NormalMode::octahedral;
 			update();
 		}
+
+		ImGui::PushID("NormalSize");
+		if(normalMode == NormalMode::spherical)
+		{
+			ImGui::Text("Normal Size (bits per component)");
+			if(ImGui::RadioButton("16", normalSize == 16))
+			{
+				normalSize = 16;
+				update();
+			}
+			ImGui::SameLine();
+			if(ImGui::RadioButton("8", normalSize == 8))
+			{
+				normalSize = 8;
+				update();
+			}
+		}
+		else
+		{
+			ImGui::Text("Normal Size (bits per normal)");
+			for(int size : {24, 16, 12, 8})
+			{
+				if(size != 24)
+					ImGui::SameLine();
+				if(ImGui::RadioButton(std::to_string(size).data(), octahedralNormalSize == size))
+				{
+					octahedralNormalSize = size;
+					update();
+				}
+			}
+		}
 		ImGui::PopID();
 	}
 
-	if(needColors() && false)
+	if(needColors() && cloud && !cloud->hasColors())
 	{
 		ImGui::Text("Current render mode needs colours");
 		ImGui::Text("but none are present in the dataset!");
 	}
+	else if(needColors())
+	{
+		ImGui::PushID("ColorSize");
+		ImGui::Text("Colour Size (bits per point)");
+		for(int size : {24, 4, 3, 2})
+		{
+			if(size != 24)
+				ImGui::SameLine();
+			if(ImGui::RadioButton(std::to_string(size).data(), colorSize == size))
+			{
+				colorSize = size;
+				update();
+			}
+		}
+		ImGui::PopID();
+		if(outOfCore)
+			ImGui::Text("Out of core bricks keep their raw colours");
+		else
+		{
+			if(colorSize != 24)
+				ImGui::Text("PSNR: %.2f dB", colorPSNR);
+			ImGui::Text("Memory Colours: ");
+			ImGui::SameLine();
+			drawMemoryConsumption(VBOColors.size());
+		}
+	}
 
 	if(renderMode != RenderMode::basic)
 	{
 		ImGui::DragFloat("Disk Radius", &diskRadius, 0.00001f, 0.00001f, 0.005f, "%.5f");
 		ImGui::Checkbox("Backface Culling", &backFaceCulling);
 	}
+
+	ImGui::Separator();
+	if(!outOfCore)
+	{
+		ImGui::Text("GPU Brick Culling");
+		if(ImGui::RadioButton("Disabled", cullingMode == CullingMode::disabled))
+			cullingMode = CullingMode::disabled;
+		ImGui::SameLine();
+		if(ImGui::RadioButton("Frustum", cullingMode == CullingMode::frustum))
+			cullingMode = CullingMode::frustum;
+		ImGui::SameLine();
+		if(ImGui::RadioButton("Frustum + Occlusion", cullingMode == CullingMode::occlusion))
+			cullingMode = CullingMode::occlusion;
+		if(cullingMode != CullingMode::disabled && !GLAD_GL_ARB_indirect_parameters)
+			ImGui::Text("GL_ARB_indirect_parameters is not supported, drawing all bricks");
+		else if(cullingMode != CullingMode::disabled)
+		{
+			ImGui::Text("Drawn Bricks: %u (%u + %u)", cullingStatistics[0] + cullingStatistics[1], cullingStatistics[0], cullingStatistics[1]);
+			ImGui::Text("Frustum Culled Bricks: %u", cullingStatistics[2]);
+			if(cullingMode == CullingMode::occlusion)
+				ImGui::Text("Occlusion Culled Bricks: %u", cullingStatistics[3]);
+		}
+	}
+	if(ImGui::Checkbox("Out Of Core", &outOfCore))
+		update();
+	if(outOfCore)
+	{
+		bool budgetsChanged = false;
+		budgetsChanged |= ImGui::InputInt("Host Budget (MB)", &hostBudgetMegaBytes, 64, 1024);
+		budgetsChanged |= ImGui::InputInt("GPU Budget (MB)", &gpuBudgetMegaBytes, 64, 1024);
+		budgetsChanged |= ImGui::InputInt("Upload Budget Per Frame (MB)", &uploadBudgetMegaBytes, 1, 16);
+		hostBudgetMegaBytes = std::max(hostBudgetMegaBytes, 1);
+		gpuBudgetMegaBytes = std::max(gpuBudgetMegaBytes, 1);
+		uploadBudgetMegaBytes = std::max(uploadBudgetMegaBytes, 1);
+		if(budgetsChanged)
+			update();
+		if(residency)
+		{
+			ImGui::Text("Resident Bricks: %zu", residency->getResidentBrickCount());
+			ImGui::Text("Loading Bricks: %zu", residency->getPendingLoadCount());
+			ImGui::Text("Drawn Pages: %zu", residency->getDrawCount());
+		}
+	}
 }
 
 void PCRendererBrickIndirect::reloadShaders()
@@ -346,4 +994,5 @@ void PCRendererBrickIndirect::reloadShaders()
 	basicShader.reload();
 	litShader.reload();
 	litColouredShader.reload();
+	cullShader.reload();
 }
@@ -0,0 +1,264 @@
+#include "PCRendererDelta.h"
+#include "Shader.h"
+#include "PointCloud.h"
+#include "Parallel.h"
+#include "imgui.h"
+
+#include <algorithm>
+
+namespace
+{
+	Shader basicShader{"shaders/pcBrickIndirect.vert", "shaders/pcBrickIndirect.frag"};
+	Shader decodeShader{"shaders/pcDecodeDelta.comp"};
+	int pointSize = 2;
+	int precisionBits = 8;
+	int decodeBudgetMegaBytes = 256;
+	constexpr std::size_t blockSize = 64;
+	constexpr std::size_t maxWorkGroupCount = 65535;
+
+	std::uint32_t getBitWidth(std::uint32_t value)
+	{
+		std::uint32_t width = 0;
+		for(; value != 0; value >>= 1)
+			width++;
+		return width;
+	}
+
+	//blocks of blockSize sorted morton codes, each stores its first code and the bit packed deltas of the others
+	//with just as many bits as its largest delta needs, offsets are relative to the start of the brick
+	std::vector<std::uint32_t> encodeBrick(Span<glm::vec3 const> positions, std::vector<std::uint32_t>& codes)
+	{
+		float cellCount = float(1 << precisionBits);
+		codes.clear();
+		for(auto const& position : positions)
+		{
+			glm::uvec3 cell = glm::clamp(position * cellCount, glm::vec3(0.0f), glm::vec3(cellCount - 1.0f));
+			codes.push_back(encodeMorton(cell));
+		}
+		std::sort(codes.begin(), codes.end());
+
+		std::size_t blockCount = (codes.size() + blockSize - 1) / blockSize;
+		std::vector<std::uint32_t> data(2 * blockCount);
+		for(std::size_t block = 0; block < blockCount; block++)
+		{
+			std::size_t first = block * blockSize;
+			std::size_t end = std::min(first + blockSize, codes.size());
+			std::uint32_t width = 0;
+			for(std::size_t point = first + 1; point < end; point++)
+				width = std::max(width, getBitWidth(codes[point] - codes[point - 1]));
+			data[2 * block] = codes[first];
+			data[2 * block + 1] = static_cast<std::uint32_t>(data.size()) | width << 27;
+
+			//every block starts on a whole word
+			std::uint64_t bits = 0;
+			std::uint32_t bitCount = 0;
+			for(std::size_t point = first + 1; point < end; point++)
+			{
+				bits |= std::uint64_t(codes[point] - codes[point - 1]) << bitCount;
+				bitCount += width;
+				if(bitCount >= 32)
+				{
+					data.push_back(static_cast<std::uint32_t>(bits));
+					bits >>= 32;
+					bitCount -= 32;
+				}
+			}
+			if(bitCount > 0)
+				data.push_back(static_cast<std::uint32_t>(bits));
+		}
+		return data;
+	}
+}
+
+PCRendererDelta::PCRendererDelta()
+	:PCRenderer(&basicShader)
+{
+}
+
+Span<std::uint32_t const> PCRendererDelta::getDeltaStream() const
+{
+	//a header per non empty brick, its word offset, point count and first point, followed by the data of every brick
+	return cloud->getPackedStream<std::uint32_t>({"deltaPositions", cloud->getSubdivisions(), precisionBits}, [&]() {
+		auto brickOffsets = cloud->getBrickOffsets();
+		std::vector<std::size_t> bricks;
+		for(std::size_t brickIndex = 0; brickIndex < cloud->getBrickCount(); brickIndex++)
+		{
+			if(brickOffsets[brickIndex] != brickOffsets[brickIndex + 1])
+				bricks.push_back(brickIndex);
+		}
+
+		std::vector<std::vector<std::uint32_t>> brickData(bricks.size());
+		parallelFor(getWorkerCount(), bricks.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+			std::vector<std::uint32_t> codes;
+			for(std::size_t brick = begin; brick < end; brick++)
+				brickData[brick] = encodeBrick(cloud->getBrickAt(bricks[brick]).positions, codes);
+		});
+
+		std::vector<std::uint32_t> stream(3 * bricks.size());
+		for(std::size_t brick = 0; brick < bricks.size(); brick++)
+		{
+			stream[3 * brick] = static_cast<std::uint32_t>(stream.size());
+			stream[3 * brick + 1] = static_cast<std::uint32_t>(brickOffsets[bricks[brick] + 1] - brickOffsets[bricks[brick]]);
+			stream[3 * brick + 2] = static_cast<std::uint32_t>(brickOffsets[bricks[brick]]);
+			stream.insert(stream.end(), brickData[brick].begin(), brickData[brick].end());
+			brickData[brick] = {};
+		}
+		return stream;
+	}, [&](Span<std::uint32_t const> stream) {
+		//the decoder writes every brick at its first point and follows the word offsets without checking them
+		auto brickOffsets = cloud->getBrickOffsets();
+		std::size_t brick = 0;
+		for(std::size_t brickIndex = 0; brickIndex < cloud->getBrickCount(); brickIndex++)
+		{
+			std::size_t brickPointCount = brickOffsets[brickIndex + 1] - brickOffsets[brickIndex];
+			if(brickPointCount == 0)
+				continue;
+			if(3 * brick + 3 > stream.size())
+				return false;
+			std::uint64_t dataOffset = stream[3 * brick];
+			if(stream[3 * brick + 1] != brickPointCount || stream[3 * brick + 2] != brickOffsets[brickIndex])
+				return false;
+			std::size_t blockCount = (brickPointCount + blockSize - 1) / blockSize;
+			if(dataOffset > stream.size() || 2 * blockCount > stream.size() - dataOffset)
+				return false;
+			for(std::size_t block = 0; block < blockCount; block++)
+			{
+				std::uint32_t deltaWidth = stream[dataOffset + 2 * block + 1] >> 27;
+				std::uint64_t deltaOffset = dataOffset + (stream[dataOffset + 2 * block + 1] & 0x07FFFFFFu);
+				std::size_t blockPointCount = std::min(blockSize, brickPointCount - block * blockSize);
+				std::uint64_t deltaWords = ((blockPointCount - 1) * deltaWidth + 31) / 32;
+				if(deltaWidth > 30 || deltaOffset > stream.size() || deltaWords > stream.size() - deltaOffset)
+					return false;
+			}
+			brick++;
+		}
+		return 3 * brick <= stream.size();
+	});
+}
+
+void PCRendererDelta::update()
+{
+	auto stream = getDeltaStream();
+
+	auto brickOffsets = cloud->getBrickOffsets();
+	std::vector<std::size_t> bricks;
+	std::size_t largestBrick = 0;
+	for(std::size_t brickIndex = 0; brickIndex < cloud->getBrickCount(); brickIndex++)
+	{
+		std::size_t brickPointCount = brickOffsets[brickIndex + 1] - brickOffsets[brickIndex];
+		if(brickPointCount == 0)
+			continue;
+		bricks.push_back(brickIndex);
+		largestBrick = std::max(largestBrick, brickPointCount);
+	}
+	brickCount = bricks.size();
+	pointCount = cloud->getPositions().size();
+
+	//same as for the bitmaps, the whole cloud is decoded in one pass if it fits into the budget,
+	//otherwise passes alternate between two segments so decoding the next one can overlap drawing the last
+	std::size_t budgetPositionCount = std::size_t(decodeBudgetMegaBytes) * 1024 * 1024 / sizeof(std::uint32_t);
+	segmentCount = 1;
+	segmentPositionCount = std::max<std::size_t>(pointCount, 1);
+	if(pointCount > budgetPositionCount)
+	{
+		segmentCount = 2;
+		segmentPositionCount = std::max(budgetPositionCount / 2, largestBrick);
+	}
+
+	passes.clear();
+	passFirstPoints.clear();
+	std::vector<DrawCommand> drawCommands(brickCount);
+	std::size_t firstBrick = 0;
+	while(firstBrick < brickCount)
+	{
+		std::size_t passFirstPoint = brickOffsets[bricks[firstBrick]];
+		std::size_t segmentStart = (passes.size() % segmentCount) * segmentPositionCount;
+		passes.push_back(firstBrick);
+		passFirstPoints.push_back(passFirstPoint);
+		std::size_t brick = firstBrick;
+		while(brick < brickCount && brickOffsets[bricks[brick] + 1] - passFirstPoint <= segmentPositionCount)
+		{
+			drawCommands[brick].count = brickOffsets[bricks[brick] + 1] - brickOffsets[bricks[brick]];
+			drawCommands[brick].first = brickOffsets[bricks[brick]] - passFirstPoint + segmentStart;
+			drawCommands[brick].baseInstance = bricks[brick];
+			brick++;
+		}
+		firstBrick = brick;
+	}
+	passes.push_back(brickCount);
+
+	bindVAO();
+	SSBODeltaStream.write({{(std::byte const*)stream.data(), stream.sizeInBytes()}});
+	SSBOPositions.reserve(segmentCount * segmentPositionCount * sizeof(std::uint32_t));
+	SSBOPositions.bind(GL_ARRAY_BUFFER);
+	glEnableVertexAttribArray(0);
+	glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, 0, (void*)(0));
+	DrawBuffer.write({{(std::byte const*)drawCommands.data(), sizeInBytes(drawCommands)}});
+}
+
+void PCRendererDelta::render(Scene const* scene)
+{
+	PCRenderer::render(scene);
+
+	mainShader->set("cloudOrigin", cloud->getBounds().first);
+	mainShader->set("brickSize", cloud->getBrickSize());
+	mainShader->set("subdivisions", glm::uvec3(cloud->getSubdivisions()));
+	mainShader->set("positionSize", 32);
+
+	bindVAO();
+	SSBODeltaStream.bindBase(0);
+	SSBOPositions.bindBase(1);
+	DrawBuffer.bind();
+	glPointSize(pointSize);
+
+	for(std::size_t pass = 0; pass + 1 < passes.size(); pass++)
+	{
+		std::size_t segmentStart = (pass % segmentCount) * segmentPositionCount;
+		decodeShader.use();
+		decodeShader.set("precisionBits", static_cast<unsigned int>(precisionBits));
+		decodeShader.set("positionsOffset", static_cast<unsigned int>(passFirstPoints[pass] - segmentStart));
+		for(std::size_t brick = passes[pass]; brick < passes[pass + 1]; brick += maxWorkGroupCount)
+		{
+			decodeShader.set("bricksOffset", brick);
+			glDispatchCompute(std::min(maxWorkGroupCount, passes[pass + 1] - brick), 1, 1);
+		}
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+		mainShader->use();
+		glMultiDrawArraysIndirect(GL_POINTS, (void*)(passes[pass] * sizeof(DrawCommand)), passes[pass + 1] - passes[pass], 0);
+	}
+}
+
+void PCRendererDelta::drawUI()
+{
+	PCRenderer::drawUI();
+	ImGui::SliderInt("Point Size", &pointSize, 1, 16);
+	if(ImGui::SliderInt("Precision (bits per axis)", &precisionBits, 5, 10))
+		update();
+	if(ImGui::InputInt("Decode Budget (MiB)", &decodeBudgetMegaBytes, 64, 256))
+	{
+		decodeBudgetMegaBytes = std::max(decodeBudgetMegaBytes, 1);
+		update();
+	}
+
+	ImGui::Text("Bits Per Point: %.2f", 8.0f * SSBODeltaStream.size() / std::max<std::size_t>(pointCount, 1));
+	ImGui::Text("Segments: %zu, Passes: %zu", segmentCount, passes.empty() ? 0 : passes.size() - 1);
+
+	ImGui::Text("Memory Delta Stream: ");
+	ImGui::SameLine();
+	drawMemoryConsumption(SSBODeltaStream.size());
+
+	ImGui::Text("Memory Decoded Positions: ");
+	ImGui::SameLine();
+	drawMemoryConsumption(SSBOPositions.size());
+
+	ImGui::Text("Memory Draw Commands: ");
+	ImGui::SameLine();
+	drawMemoryConsumption(DrawBuffer.size());
+}
+
+void PCRendererDelta::reloadShaders()
+{
+	basicShader.reload();
+	decodeShader.reload();
+}
@@ -0,0 +1,221 @@
+#include "PCRendererOctree.h"
+#include "Shader.h"
+#include "PointCloud.h"
+#include "PointCloudOctree.h"
+#include "Scene.h"
+#include "OSWindow.h"
+#include "imgui.h"
+
+#include <algorithm>
+
+enum class RenderMode
+{
+	basic,
+	lit,
+	litColoured
+};
+
+namespace
+{
+	Shader basicShader{"shaders/pcOctree.vert", "shaders/pcBrickIndirect.frag"};
+	Shader litShader{"shaders/pcOctreeLit.vert", "shaders/pcLitDisk.frag", "shaders/pcLitDisk.geom"};
+	Shader litColouredShader{"shaders/pcOctreeLitColored.vert", "shaders/pcLitDiskColored.frag", "shaders/pcLitDiskColored.geom"};
+	RenderMode renderMode = RenderMode::basic;
+
+	bool backFaceCulling = true;
+	int pointSize = 2;
+	float diskRadius = 0.0005f;
+	int pointBudget = 5'000'000;
+	float maxScreenError = 1.0f;
+	bool freezeSelection = false;
+}
+
+PCRendererOctree::PCRendererOctree()
+	:PCRenderer(&basicShader)
+{
+}
+
+bool PCRendererOctree::needNormals() const
+{
+	return renderMode != RenderMode::basic;
+}
+
+bool PCRendererOctree::needColors() const
+{
+	return renderMode == RenderMode::litColoured;
+}
+
+void PCRendererOctree::update()
+{
+	switch(renderMode)
+	{
+		case RenderMode::basic:
+			mainShader = &basicShader;
+			break;
+		case RenderMode::lit:
+			mainShader = &litShader;
+			break;
+		case RenderMode::litColoured:
+			mainShader = &litColouredShader;
+			break;
+	}
+
+	//a frozen selection only carries over to the same octree
+	if(octree != &cloud->getOctree())
+	{
+		selection.clear();
+		drawCommands.clear();
+		selectedPointCount = 0;
+	}
+	octree = &cloud->getOctree();
+	auto nodes = octree->getNodes();
+	auto positions = octree->getPositions();
+
+	std::vector<glm::vec4> nodeBoxes;
+	nodeBoxes.reserve(nodes.size());
+	for(auto const& node : nodes)
+		nodeBoxes.emplace_back(node.origin, node.size);
+
+	bindVAO();
+	VBOPositions.write({{(std::byte const*)positions.data(), positions.sizeInBytes()}});
+	VBOPositions.bind();
+	glEnableVertexAttribArray(0);//Compressed Positions
+	glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, 0, (void*)(0));
+
+	SSBONodes.write({{(std::byte const*)nodeBoxes.data(), sizeInBytes(nodeBoxes)}});
+	//at most one draw command per node, the selection is rewritten every frame
+	DrawBuffer.reserveStreaming(nodes.size() * sizeof(DrawCommand));
+
+	if(needNormals() && !octree->getNormals().empty())
+	{
+		VBONormals.write({{(std::byte const*)octree->getNormals().data(), octree->getNormals().sizeInBytes()}});
+		VBONormals.bind();
+		glEnableVertexAttribArray(1);//Octahedral Normals
+		glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, 0, (void*)(0));
+	}
+	else
+	{
+		VBONormals.free();
+		glDisableVertexAttribArray(1);
+	}
+
+	if(needColors() && !octree->getColors().empty())
+	{
+		VBOColors.write({{(std::byte const*)octree->getColors().data(), octree->getColors().sizeInBytes()}});
+		VBOColors.bind();
+		glEnableVertexAttribArray(2);//Colors
+		glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, true, 0, (void*)(0));
+	}
+	else
+	{
+		VBOColors.free();
+		glDisableVertexAttribArray(2);
+	}
+}
+
+void PCRendererOctree::render(Scene const* scene)
+{
+	PCRenderer::render(scene);
+
+	if(renderMode != RenderMode::basic)
+	{
+		mainShader->set("diskRadius", diskRadius * scene->getScaling());
+		mainShader->set("backFaceCulling", backFaceCulling);
+		mainShader->set("specularColor", scene->getSpecularColor());
+		mainShader->set("shininess", scene->getShininess());
+		mainShader->set("ambientStrength", scene->getAmbientStrength());
+		mainShader->set("ambientColor", scene->getBackgroundColor());
+		mainShader->set("light.color", scene->getLightColor());
+		mainShader->set("light.direction", glm::vec3(scene->getCamera().getViewMatrix() * glm::vec4(scene->getLightDirection(), 0.0f)));
+	}
+	glPointSize(pointSize);
+
+	if(!freezeSelection)
+	{
+		glm::mat4 modelView = scene->getCamera().getViewMatrix() * scene->getModelMatrix();
+		glm::mat4 projection = scene->getCamera().getProjectionMatrix();
+		glm::vec3 cameraPosition = glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		//pixels covered by one unit at distance one, the error of a node is independent of the model scaling
+		float projectionScale = 0.5f * OSWindow::getSize().y * projection[1][1];
+		selectedPointCount = octree->selectNodes(projection * modelView, cameraPosition, projectionScale, maxScreenError, pointBudget, selection);
+
+		auto nodes = octree->getNodes();
+		drawCommands.clear();
+		for(auto nodeIndex : selection)
+		{
+			DrawCommand nodeDrawCommand{};
+			nodeDrawCommand.count = nodes[nodeIndex].count;
+			nodeDrawCommand.first = nodes[nodeIndex].offset;
+			nodeDrawCommand.baseInstance = nodeIndex;
+			drawCommands.push_back(nodeDrawCommand);
+		}
+	}
+	//written even when frozen, update reserves the draw buffer anew
+	DrawBuffer.advanceRegion();
+	if(!drawCommands.empty())
+	{
+		drawOffset = *DrawBuffer.allocate(sizeInBytes(drawCommands));
+		DrawBuffer.writeMapped(drawOffset, (std::byte const*)drawCommands.data(), sizeInBytes(drawCommands));
+	}
+
+	bindVAO();
+	SSBONodes.bindBase(0);
+	DrawBuffer.bind();
+	glMultiDrawArraysIndirect(GL_POINTS, (void*)drawOffset, drawCommands.size(), 0);
+}
+
+void PCRendererOctree::drawUI()
+{
+	PCRenderer::drawUI();
+	ImGui::SliderInt("Point Size", &pointSize, 1, 16);
+
+	ImGui::Text("Render Mode");
+	if(ImGui::RadioButton("Basic", renderMode == RenderMode::basic))
+	{
+		renderMode = RenderMode::basic;
+		update();
+	}
+	ImGui::SameLine();
+	if(ImGui::RadioButton("Lit", renderMode == RenderMode::lit))
+	{
+		renderMode = RenderMode::lit;
+		update();
+	}
+	ImGui::SameLine();
+	if(ImGui::RadioButton("Lit Coloured", renderMode == RenderMode::litColoured))
+	{
+		renderMode = RenderMode::litColoured;
+		update();
+	}
+
+	if(needNormals() && cloud && !cloud->hasNormals())
+	{
+		ImGui::Text("Current render mode needs normals");
+		ImGui::Text("but none are present in the dataset!");
+	}
+
+	if(renderMode != RenderMode::basic)
+	{
+		ImGui::DragFloat("Disk Radius", &diskRadius, 0.00001f, 0.00001f, 0.005f, "%.5f");
+		ImGui::Checkbox("Backface Culling", &backFaceCulling);
+	}
+
+	ImGui::Separator();
+	ImGui::InputInt("Point Budget", &pointBudget, 100'000, 1'000'000);
+	pointBudget = std::max(pointBudget, 1);
+	ImGui::DragFloat("Max Screen Error (px)", &maxScreenError, 0.01f, 0.1f, 16.0f, "%.2f");
+	ImGui::Checkbox("Freeze LOD", &freezeSelection);
+	if(octree)
+	{
+		ImGui::Text("Octree Nodes: %zu, Depth: %u", octree->getNodes().size(), octree->getDepth());
+		ImGui::Text("Selected Nodes: %zu", selection.size());
+		ImGui::Text("Selected Points: %zu (%.2f%%)", selectedPointCount, 100 * static_cast<float>(selectedPointCount) / std::max<std::size_t>(1, octree->getPositions().size()));
+	}
+}
+
+void PCRendererOctree::reloadShaders()
+{
+	basicShader.reload();
+	litShader.reload();
+	litColouredShader.reload();
+}
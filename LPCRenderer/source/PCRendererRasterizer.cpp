@@ -0,0 +1,204 @@
+#include "PCRendererRasterizer.h"
+#include "Shader.h"
+#include "PointCloud.h"
+#include "Scene.h"
+#include "imgui.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	Shader rasterizeShader{"shaders/pcRasterize.comp"};
+	Shader resolveShader{"shaders/pcResolveVisibility.vert", "shaders/pcResolveVisibility.frag"};
+	int positionSize = 32;
+	bool colored = true;
+	constexpr std::size_t maxWorkGroupCount = 65535;
+
+	//64 bit atomics in shader storage, without them only the depth fits into a pixel
+	bool hasAtomicInt64()
+	{
+		static bool const supported = []() {
+			bool int64 = false;
+			bool atomicInt64 = false;
+			int extensionCount = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+			for(int i = 0; i < extensionCount; i++)
+			{
+				char const* extension = reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, i));
+				int64 = int64 || std::strcmp(extension, "GL_ARB_gpu_shader_int64") == 0;
+				atomicInt64 = atomicInt64 || std::strcmp(extension, "GL_NV_shader_atomic_int64") == 0;
+			}
+			return int64 && atomicInt64;
+		}();
+		return supported;
+	}
+}
+
+PCRendererRasterizer::PCRendererRasterizer()
+	:PCRenderer(&rasterizeShader)
+{
+}
+
+bool PCRendererRasterizer::drawsColors() const
+{
+	return colored && cloud->hasColors();
+}
+
+std::size_t PCRendererRasterizer::getVisibilityWords() const
+{
+	return hasAtomicInt64() ? 2 : 1;
+}
+
+void PCRendererRasterizer::update()
+{
+	//the same streams as the brick indirect renderer, whichever renderer comes first packs them
+	auto drawCommands = cloud->getPackedStream<DrawCommand>({"drawCommands", cloud->getSubdivisions()}, [&]() {
+		std::vector<DrawCommand> drawCommands;
+		auto brickOffsets = cloud->getBrickOffsets();
+		for(std::size_t brickIndex = 0; brickIndex < cloud->getBrickCount(); brickIndex++)
+		{
+			if(brickOffsets[brickIndex] == brickOffsets[brickIndex + 1])
+				continue;
+			DrawCommand drawCommand{};
+			drawCommand.count = brickOffsets[brickIndex + 1] - brickOffsets[brickIndex];
+			drawCommand.first = brickOffsets[brickIndex];
+			drawCommand.baseInstance = brickIndex;
+			drawCommands.push_back(drawCommand);
+		}
+		return drawCommands;
+	}, [&](Span<DrawCommand const> drawCommands) {
+		return isBrickDrawCommandStream(drawCommands);
+	});
+	drawCommandCount = drawCommands.size();
+	SSBODrawCommands.write({{(std::byte const*)drawCommands.data(), drawCommands.sizeInBytes()}});
+
+	if(positionSize == 32)
+	{
+		auto positions = cloud->getPackedStream<std::uint32_t>({"positions", cloud->getSubdivisions(), 32}, [&]() {
+			std::vector<std::uint32_t> positions;
+			positions.reserve(cloud->getPositions().size());
+			for(auto const& position : cloud->getPositions())
+				positions.push_back(packPosition1024(position));
+			return positions;
+		}, [&](Span<std::uint32_t const> positions) {
+			return isPointStream(positions.size());
+		});
+		SSBOPositions.write({{(std::byte const*)positions.data(), positions.sizeInBytes()}});
+		cloud->setBrickPrecision(1024);
+	}
+	else
+	{
+		//the shader reads whole words, so an odd count is padded
+		auto positions = cloud->getPackedStream<std::uint16_t>({"positions", cloud->getSubdivisions(), 16}, [&]() {
+			std::vector<std::uint16_t> positions;
+			positions.reserve(cloud->getPositions().size());
+			for(auto const& position : cloud->getPositions())
+				positions.push_back(packPosition32(position));
+			return positions;
+		}, [&](Span<std::uint16_t const> positions) {
+			return isPointStream(positions.size());
+		});
+		std::uint16_t padding = 0;
+		SSBOPositions.write({{(std::byte const*)positions.data(), positions.sizeInBytes()}, {(std::byte const*)&padding, positions.size() % 2 * sizeof(padding)}});
+		cloud->setBrickPrecision(32);
+	}
+
+	if(drawsColors())
+	{
+		//padded to whole words like the positions
+		std::uint8_t padding[3]{};
+		auto colors = cloud->getColors();
+		SSBOColors.write({{(std::byte const*)colors.data(), colors.sizeInBytes()}, {(std::byte const*)padding, (4 - colors.sizeInBytes() % 4) % 4}});
+	}
+	else
+		SSBOColors.free();
+}
+
+void PCRendererRasterizer::render(Scene const* scene)
+{
+	PCRenderer::render(scene);
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glm::ivec2 viewportSize{viewport[2], viewport[3]};
+	std::size_t visibilitySize = std::size_t(viewportSize.x) * viewportSize.y * getVisibilityWords() * sizeof(std::uint32_t);
+	if(viewportSize != resolution || SSBOVisibility.size() != visibilitySize)
+	{
+		resolution = viewportSize;
+		SSBOVisibility.reserve(visibilitySize);
+	}
+	if(visibilitySize == 0)
+		return;
+	SSBOVisibility.clear();
+
+	//model, view, projection and diffuseColor are set by the caller like for every other main shader
+	rasterizeShader.use();
+	rasterizeShader.set("cloudOrigin", cloud->getBounds().first);
+	rasterizeShader.set("brickSize", cloud->getBrickSize());
+	rasterizeShader.set("subdivisions", glm::uvec3(cloud->getSubdivisions()));
+	rasterizeShader.set("positionSize", positionSize);
+	rasterizeShader.set("colored", drawsColors());
+	rasterizeShader.set("resolution", resolution);
+	SSBODrawCommands.bindBase(0);
+	SSBOPositions.bindBase(1);
+	if(drawsColors())
+		SSBOColors.bindBase(2);
+	SSBOVisibility.bindBase(3);
+	for(std::size_t brick = 0; brick < drawCommandCount; brick += maxWorkGroupCount)
+	{
+		rasterizeShader.set("bricksOffset", brick);
+		glDispatchCompute(std::min(maxWorkGroupCount, drawCommandCount - brick), 1, 1);
+	}
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	//writes the depth too, so the brick boxes and whatever is drawn afterwards still sort against the points
+	resolveShader.use();
+	resolveShader.set("resolution", resolution);
+	resolveShader.set("visibilityWords", static_cast<int>(getVisibilityWords()));
+	resolveShader.set("diffuseColor", scene->getDiffuseColor());
+	bindVAO();
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void PCRendererRasterizer::drawUI()
+{
+	PCRenderer::drawUI();
+	ImGui::Text("Position Size");
+	if(ImGui::RadioButton("32", positionSize == 32))
+	{
+		positionSize = 32;
+		update();
+	}
+	ImGui::SameLine();
+	if(ImGui::RadioButton("16", positionSize == 16))
+	{
+		positionSize = 16;
+		update();
+	}
+	if(ImGui::Checkbox("Coloured", &colored))
+		update();
+
+	if(!hasAtomicInt64())
+		ImGui::Text("64 bit atomics are not supported, drawing depth only");
+	else if(colored && cloud && !cloud->hasColors())
+		ImGui::Text("The dataset has no colours");
+
+	ImGui::Text("Memory Positions: ");
+	ImGui::SameLine();
+	drawMemoryConsumption(SSBOPositions.size());
+
+	ImGui::Text("Memory Colours: ");
+	ImGui::SameLine();
+	drawMemoryConsumption(SSBOColors.size());
+
+	ImGui::Text("Memory Visibility Buffer: ");
+	ImGui::SameLine();
+	drawMemoryConsumption(SSBOVisibility.size());
+}
+
+void PCRendererRasterizer::reloadShaders()
+{
+	rasterizeShader.reload();
+	resolveShader.reload();
+}
@@ -28,6 +28,7 @@ namespace
 	float diskRadius = 0.0005f;
 	float debugNormalsLineLength = 0.001f;
 	int debugNormalsLineThickness = 2;
+	bool vertexPulling = true;
 }
 
 PCRendererUncompressed::PCRendererUncompressed()
@@ -60,29 +61,14 @@ void PCRendererUncompressed::update()
 	}
 	if(needNormals() && !cloud->hasNormals())
 		return;
-	vertexCount = 0;
-	for(auto const& brick : cloud->getAllBricks())
-		vertexCount += brick.positions.size();
+	vertexCount = cloud->getPositions().size();
 
-	static std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> positions;
 	positions.reserve(vertexCount);
-	static std::vector<glm::vec3> normals;
-	if(needNormals())
-		normals.reserve(vertexCount);
-
 	for(auto const& brick : cloud->getAllBricks())
 	{
-		if(brick.positions.empty())
-			continue;
-
 		for(glm::vec3 position : brick.positions)
 			positions.push_back(cloud->convertToWorldPosition(brick.indices, position));
-		if(needNormals())
-		{
-			for(glm::vec3 normal : brick.normals)
-				normals.push_back(normal);
-		}
-
 	}
 
 	bindVAO();
@@ -90,7 +76,7 @@ void PCRendererUncompressed::update()
 	{
 		VBO.write({
 			{ (std::byte const*)positions.data(), sizeInBytes(positions) },
-			{ (std::byte const*)normals.data(), sizeInBytes(normals) }
+			{ (std::byte const*)cloud->getNormals().data(), cloud->getNormals().sizeInBytes() }
 			});
 		VBO.bind();
 		glEnableVertexAttribArray(1);//Normals
@@ -105,9 +91,13 @@ void PCRendererUncompressed::update()
 	glEnableVertexAttribArray(0);//Positions
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
 
-
-	positions.clear();
-	normals.clear();
+	//the attributes stay set up, so clouds too large for a storage block still draw through them
+	pullingVertices = vertexPulling && VBO.size() <= getMaxShaderStorageBlockSize();
+	if(pullingVertices)
+	{
+		glDisableVertexAttribArray(0);
+		glDisableVertexAttribArray(1);
+	}
 }
 
 void PCRendererUncompressed::render(Scene const* scene)
@@ -139,6 +129,16 @@ void PCRendererUncompressed::render(Scene const* scene)
 			break;
 	}
 
+	//the normals follow all positions in the same buffer
+	mainShader->set("vertexPulling", pullingVertices);
+	if(pullingVertices)
+	{
+		mainShader->set("positionOffset", 0u);
+		mainShader->set("normalOffset", 3 * vertexCount);
+		mainShader->set("vertexStride", 3u);
+		VBO.bindBase(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
 	bindVAO();
 	glDrawArrays(GL_POINTS, 0, vertexCount);
 }
@@ -173,6 +173,11 @@ void PCRendererUncompressed::drawUI()
 		renderMode = RenderMode::debugNormals;
 		update();
 	}
+	if(ImGui::Checkbox("Vertex Pulling", &vertexPulling))
+		update();
+	if(vertexPulling && cloud && !pullingVertices)
+		ImGui::Text("The cloud exceeds the largest storage block, using vertex attributes");
+
 	if(needNormals() && cloud && !cloud->hasNormals())
 	{
 		ImGui::Text("Current render mode needs normals"); 
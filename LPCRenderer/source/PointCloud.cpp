@@ -1,21 +1,97 @@
 #include "PointCloud.h"
 #include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <tuple>
 #include <imgui.h>
 #include <unordered_map>
 #include <PCManager.h>
 #include <Scene.h>
 #include <SceneManager.h>
 #include "GPUBuffer.h"
+#include "Parallel.h"
+#include "BrickCache.h"
+#include "PointCloudOctree.h"
+
+namespace
+{
+	//per cloud, packed streams beyond it are evicted least recently used first
+	constexpr std::size_t packedStreamBudget = std::size_t(2) << 30;
+}
+
+bool PackedStreamKey::operator<(PackedStreamKey const& other) const
+{
+	return std::tie(name, subdivisions.x, subdivisions.y, subdivisions.z, positionBits, normalBits, bitmapSize, errorBits)
+		< std::tie(other.name, other.subdivisions.x, other.subdivisions.y, other.subdivisions.z, other.positionBits, other.normalBits, other.bitmapSize, other.errorBits);
+}
+
+bool PackedStreamKey::operator==(PackedStreamKey const& other) const
+{
+	return std::tie(name, subdivisions.x, subdivisions.y, subdivisions.z, positionBits, normalBits, bitmapSize, errorBits)
+		== std::tie(other.name, other.subdivisions.x, other.subdivisions.y, other.subdivisions.z, other.positionBits, other.normalBits, other.bitmapSize, other.errorBits);
+}
+
+PointCloudBricks::Iterator::Iterator(PointCloudBricks const* bricks, std::size_t idx)
+	:bricks(bricks), idx(idx)
+{
+}
+
+PointCloudBrick PointCloudBricks::Iterator::operator*() const
+{
+	return (*bricks)[idx];
+}
+
+PointCloudBricks::Iterator& PointCloudBricks::Iterator::operator++()
+{
+	idx++;
+	return *this;
+}
+
+bool PointCloudBricks::Iterator::operator==(Iterator const& other) const
+{
+	return idx == other.idx;
+}
+
+bool PointCloudBricks::Iterator::operator!=(Iterator const& other) const
+{
+	return idx != other.idx;
+}
+
+PointCloudBricks::PointCloudBricks(PointCloud const* cloud)
+	:cloud(cloud)
+{
+}
+
+std::size_t PointCloudBricks::size() const
+{
+	return cloud->getBrickCount();
+}
+
+PointCloudBrick PointCloudBricks::operator[](std::size_t idx) const
+{
+	return cloud->getBrickAt(idx);
+}
+
+PointCloudBricks::Iterator PointCloudBricks::begin() const
+{
+	return {this, 0};
+}
+
+PointCloudBricks::Iterator PointCloudBricks::end() const
+{
+	return {this, size()};
+}
 
 PointCloud::PointCloud(std::vector<glm::vec3>&& positions, std::vector<glm::vec3>&& normals, std::vector<glm::u8vec3>&& colors)
-	:vertexCount(positions.size())
+	:ownedPositions(std::move(positions)), ownedNormals(std::move(normals)), ownedColors(std::move(colors)), vertexCount(ownedPositions.size())
 {
 	for (int i = 0; i < 3; i++)
 	{
 		bounds.first[i] = +std::numeric_limits<float>::max();
 		bounds.second[i] = -std::numeric_limits<float>::max();
 	}
-	for (auto const& position : positions)
+	for (auto const& position : ownedPositions)
 	{
 		for (int i = 0; i < 3; i++)
 		{
@@ -23,12 +99,25 @@ PointCloud::PointCloud(std::vector<glm::vec3>&& positions, std::vector<glm::vec3
 			bounds.second[i] = std::max(bounds.second[i], position[i]);
 		}
 	}
+	_hasNormals = !ownedNormals.empty();
+	_hasColors = !ownedColors.empty();
+	brickSize = getSize() / glm::vec3(subdivisions + 1);
+	for (auto& position : ownedPositions)
+		position = glm::fract((position - bounds.first) / brickSize);
+	ownedBrickOffsets = {0, vertexCount};
+	viewOwnedStorage();
+}
+
+PointCloud::PointCloud(PointCloudStorage storage)
+	:bounds(storage.bounds), subdivisions(storage.subdivisions), positions(storage.positions), normals(storage.normals), colors(storage.colors),
+	brickOffsets(storage.brickOffsets), storageOwner(std::move(storage.owner)), storageMapping(storage.mapping), packedStreams(std::move(storage.packedStreams)),
+	vertexCount(storage.positions.size())
+{
 	_hasNormals = !normals.empty();
 	_hasColors = !colors.empty();
 	brickSize = getSize() / glm::vec3(subdivisions + 1);
-	for (auto& position : positions)
-		position = glm::fract((position - bounds.first) / brickSize);
-	bricks.push_back(PointCloudBrick{ { 0, 0, 0 }, std::move(positions), std::move(normals), std::move(colors)});
+	//only the brick table is touched here so that the points themselves can stay paged out
+	updateBrickStatistics();
 }
 
 std::string PointCloud::getNamePrefix() const
@@ -36,85 +125,178 @@ std::string PointCloud::getNamePrefix() const
 	return "PointCloud";
 }
 
+//the statistics pass touches every point, so renderers may call this on every update
 void PointCloud::setBrickPrecision(std::size_t precision) const
 {
 	this->brickPrecision = precision;
-	updateStatistics();
+	if(statisticsPrecision != precision)
+		updateStatistics();
 }
 
-void PointCloud::updateStatistics() const
+void PointCloud::updateBrickStatistics() const
 {
 	emptyBrickCount = 0;
-	redundantPointsIfCompressed = 0;
-	for(auto const& brick : bricks)
+	for(std::size_t brickIndex = 0; brickIndex < getBrickCount(); brickIndex++)
 	{
-		if(brick.positions.empty())
-		{
+		if(brickOffsets[brickIndex] == brickOffsets[brickIndex + 1])
 			emptyBrickCount++;
-			continue;
-		}
+	}
+	pointsPerBrickAverage = 0;
+	if(emptyBrickCount != getBrickCount())
+		pointsPerBrickAverage = static_cast<float>(vertexCount) / (getBrickCount() - emptyBrickCount);
+}
+
+void PointCloud::updateStatistics() const
+{
+	updateBrickStatistics();
+	statisticsPrecision = brickPrecision;
+
+	//bricks are counted independently, so every chunk only sums up its own bricks,
+	//more chunks than workers as the points cluster in few bricks and chunks are claimed as workers free up
+	std::size_t chunkCount = 8 * getWorkerCount();
+	std::vector<std::size_t> redundantPoints(chunkCount, 0);
+	parallelFor(chunkCount, getBrickCount(), [&](std::size_t chunk, std::size_t begin, std::size_t end) {
 		std::unordered_map<std::uint32_t, std::size_t> occurences;
-		for(auto const& position : brick.positions)
+		for(std::size_t brickIndex = begin; brickIndex < end; brickIndex++)
 		{
-			switch(brickPrecision)
+			PointCloudBrick brick = getBrickAt(brickIndex);
+			if(brick.positions.empty())
+				continue;
+			occurences.clear();
+			for(auto const& position : brick.positions)
 			{
-				case 1024:
-					occurences[packPosition1024(position)]++;
-					break;
-				case 32:
-					occurences[packPosition32(position)]++;
-					break;
-				case 16:
-					occurences[packPosition16(position)]++;
-					break;
-				case 8:
-					occurences[packPosition8(position)]++;
-					break;
-				case 4:
-					occurences[packPosition4(position)]++;
-					break;
+				switch(brickPrecision)
+				{
+					case 1024:
+						occurences[packPosition1024(position)]++;
+						break;
+					case 32:
+						occurences[packPosition32(position)]++;
+						break;
+					case 16:
+						occurences[packPosition16(position)]++;
+						break;
+					case 8:
+						occurences[packPosition8(position)]++;
+						break;
+					case 4:
+						occurences[packPosition4(position)]++;
+						break;
+				}
 			}
+			for(auto n : occurences)
+				redundantPoints[chunk] += n.second - 1;
 		}
-		for(auto n : occurences)
-			redundantPointsIfCompressed += n.second - 1;
-	}
-	pointsPerBrickAverage = 0;
-	for(auto const& brick : bricks)
-	{
-		if(brick.positions.empty())
-			continue;
-		pointsPerBrickAverage += static_cast<float>(brick.positions.size()) / (bricks.size() - emptyBrickCount);
-	}
+	});
+	redundantPointsIfCompressed = std::accumulate(redundantPoints.begin(), redundantPoints.end(), std::size_t(0));
 }
 
 void PointCloud::setSubDivisions(glm::ivec3 subdivisions)
 {
-	this->subdivisions = subdivisions;
-	std::vector<PointCloudBrick> oldBricks;
-	for (int k = 0; k <= subdivisions.z; k++)
-		for (int j = 0; j <= subdivisions.y; j++)
-			for (int i = 0; i <= subdivisions.x; i++)
-				oldBricks.push_back(PointCloudBrick{ { i, j, k } });
-	std::swap(oldBricks, bricks);
+	glm::ivec3 oldSubdivisions = this->subdivisions;
+	std::vector<std::size_t> oldBrickOffsets(brickOffsets.begin(), brickOffsets.end());
 	glm::vec3 oldBrickSize = brickSize;
+	this->subdivisions = subdivisions;
 	brickSize = getSize() / glm::vec3(subdivisions + 1);
 
-	for (auto const& brick : oldBricks)
-	{
-		for (int i = 0; i < brick.positions.size(); i++)
+	std::size_t brickCount = std::size_t(subdivisions.x + 1) * (subdivisions.y + 1) * (subdivisions.z + 1);
+
+	//the old bricks are stored back to back, so each worker simply gets an equal share of points
+	auto forEachPoint = [&](std::size_t begin, std::size_t end, auto&& function) {
+		std::size_t brickIndex = std::upper_bound(oldBrickOffsets.begin(), oldBrickOffsets.end(), begin) - oldBrickOffsets.begin() - 1;
+		for (std::size_t point = begin; point < end; brickIndex++)
 		{
-			glm::vec3 globalPosition = oldBrickSize * (brick.positions[i] + glm::vec3(brick.indices));
-			glm::vec3 relativePosition = globalPosition / brickSize;
-			glm::ivec3 indices = glm::floor(relativePosition);
-			relativePosition = glm::fract(relativePosition);
-			getBrickAt(indices).positions.push_back(relativePosition);
-			if (_hasNormals)
-				getBrickAt(indices).normals.push_back(brick.normals[i]);
-			if(_hasColors)
-				getBrickAt(indices).colors.push_back(brick.colors[i]);
+			glm::vec3 brickIndices = glm::vec3(getBrickIndices(brickIndex, oldSubdivisions));
+			std::size_t last = std::min(end, oldBrickOffsets[brickIndex + 1]);
+			for (; point < last; point++)
+				function(brickIndices, point);
 		}
+	};
+
+	auto locate = [&](glm::vec3 oldBrickIndices, std::size_t point, glm::vec3& relativePosition) {
+		glm::vec3 globalPosition = oldBrickSize * (positions[point] + oldBrickIndices);
+		relativePosition = globalPosition / brickSize;
+		glm::ivec3 indices = glm::floor(relativePosition);
+		relativePosition = glm::fract(relativePosition);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			//points on the upper bounds would land one brick past the end of the grid
+			if (indices[axis] > subdivisions[axis])
+			{
+				indices[axis] = subdivisions[axis];
+				relativePosition[axis] = std::nextafter(1.0f, 0.0f);
+			}
+		}
+		return getBrickIndex(indices);
+	};
+
+	//one histogram per worker, capped so that all histograms together never outgrow the points themselves
+	std::size_t workerCount = std::min(getWorkerCount(), std::max<std::size_t>(1, vertexCount / brickCount));
+	std::vector<std::vector<std::size_t>> histograms(workerCount);
+
+	parallelFor(workerCount, vertexCount, [&](std::size_t worker, std::size_t begin, std::size_t end) {
+		auto& histogram = histograms[worker];
+		histogram.resize(brickCount, 0);
+		glm::vec3 relativePosition;
+		forEachPoint(begin, end, [&](glm::vec3 oldBrickIndices, std::size_t point) {
+			histogram[locate(oldBrickIndices, point, relativePosition)]++;
+		});
+	});
+	for (auto& histogram : histograms)
+		histogram.resize(brickCount, 0);
+
+	std::vector<std::size_t> newBrickOffsets(brickCount + 1);
+	newBrickOffsets[0] = 0;
+	for (std::size_t brickIndex = 0; brickIndex < brickCount; brickIndex++)
+	{
+		std::size_t brickPointCount = 0;
+		for (auto const& histogram : histograms)
+			brickPointCount += histogram[brickIndex];
+		newBrickOffsets[brickIndex + 1] = newBrickOffsets[brickIndex] + brickPointCount;
 	}
 
+	//turn the counts into per worker write cursors, workers keep their original relative order
+	parallelFor(getWorkerCount(), brickCount, [&](std::size_t, std::size_t begin, std::size_t end) {
+		for (std::size_t brickIndex = begin; brickIndex < end; brickIndex++)
+		{
+			std::size_t cursor = newBrickOffsets[brickIndex];
+			for (auto& histogram : histograms)
+			{
+				std::size_t workerPointCount = histogram[brickIndex];
+				histogram[brickIndex] = cursor;
+				cursor += workerPointCount;
+			}
+		}
+	});
+
+	std::vector<glm::vec3> newPositions(vertexCount);
+	std::vector<glm::vec3> newNormals(_hasNormals ? vertexCount : 0);
+	std::vector<glm::u8vec3> newColors(_hasColors ? vertexCount : 0);
+
+	parallelFor(workerCount, vertexCount, [&](std::size_t worker, std::size_t begin, std::size_t end) {
+		auto& cursors = histograms[worker];
+		glm::vec3 relativePosition;
+		forEachPoint(begin, end, [&](glm::vec3 oldBrickIndices, std::size_t point) {
+			std::size_t idx = cursors[locate(oldBrickIndices, point, relativePosition)]++;
+			newPositions[idx] = relativePosition;
+			if (_hasNormals)
+				newNormals[idx] = normals[point];
+			if (_hasColors)
+				newColors[idx] = colors[point];
+		});
+	});
+
+	//every stream was packed from the old point order, even those of the same subdivisions
+	//would not survive points on brick boundaries moving between bricks
+	clearPackedStreams();
+	ownedPositions = std::move(newPositions);
+	ownedNormals = std::move(newNormals);
+	ownedColors = std::move(newColors);
+	ownedBrickOffsets = std::move(newBrickOffsets);
+	viewOwnedStorage();
+	storageOwner.reset();
+	storageMapping = nullptr;
+
 	updateStatistics();
 }
 
@@ -148,19 +330,148 @@ glm::vec3 PointCloud::getBrickSize() const
 	return brickSize;
 }
 
-std::vector<PointCloudBrick> const& PointCloud::getAllBricks() const
+std::size_t PointCloud::getBrickCount() const
+{
+	return brickOffsets.size() - 1;
+}
+
+PointCloudBricks PointCloud::getAllBricks() const
 {
-	return bricks;
+	return {this};
 }
 
-PointCloudBrick& PointCloud::getBrickAt(glm::ivec3 indices)
+std::size_t PointCloud::getBrickIndex(glm::ivec3 indices) const
 {
-	int idx = 0;
+	std::size_t idx = 0;
 	idx += indices.x;//jump points
-	idx += indices.y * (subdivisions.x + 1);//jump lines
-	idx += indices.z * (subdivisions.x + 1) * (subdivisions.y + 1);//jump surfaces
+	idx += indices.y * std::size_t(subdivisions.x + 1);//jump lines
+	idx += indices.z * std::size_t(subdivisions.x + 1) * (subdivisions.y + 1);//jump surfaces
+	return idx;
+}
 
-	return bricks[idx];
+glm::ivec3 PointCloud::getBrickIndices(std::size_t idx, glm::ivec3 subdivisions)
+{
+	glm::ivec3 indices;
+	indices.z = idx / (std::size_t(subdivisions.x + 1) * (subdivisions.y + 1));//count surfaces
+	idx %= std::size_t(subdivisions.x + 1) * (subdivisions.y + 1);
+	indices.y = idx / (subdivisions.x + 1);//count lines
+	indices.x = idx % (subdivisions.x + 1);//count points
+	return indices;
+}
+
+void PointCloud::viewOwnedStorage()
+{
+	positions = {ownedPositions.data(), ownedPositions.size()};
+	normals = {ownedNormals.data(), ownedNormals.size()};
+	colors = {ownedColors.data(), ownedColors.size()};
+	brickOffsets = {ownedBrickOffsets.data(), ownedBrickOffsets.size()};
+}
+
+PointCloudBrick PointCloud::getBrickAt(std::size_t idx) const
+{
+	std::size_t offset = brickOffsets[idx];
+	std::size_t count = brickOffsets[idx + 1] - offset;
+	PointCloudBrick brick{getBrickIndices(idx, subdivisions)};
+	brick.positions = {positions.data() + offset, count};
+	if(_hasNormals)
+		brick.normals = {normals.data() + offset, count};
+	if(_hasColors)
+		brick.colors = {colors.data() + offset, count};
+	return brick;
+}
+
+PointCloudBrick PointCloud::getBrickAt(glm::ivec3 indices) const
+{
+	return getBrickAt(getBrickIndex(indices));
+}
+
+Span<glm::vec3 const> PointCloud::getPositions() const
+{
+	return positions;
+}
+
+Span<glm::vec3 const> PointCloud::getNormals() const
+{
+	return normals;
+}
+
+Span<glm::u8vec3 const> PointCloud::getColors() const
+{
+	return colors;
+}
+
+Span<std::size_t const> PointCloud::getBrickOffsets() const
+{
+	return brickOffsets;
+}
+
+std::shared_ptr<void const> const& PointCloud::getStorageOwner() const
+{
+	return storageOwner;
+}
+
+MappedFile const* PointCloud::getStorageMapping() const
+{
+	return storageMapping;
+}
+
+std::map<PackedStreamKey, PackedStream> const& PointCloud::getPackedStreams() const
+{
+	return packedStreams;
+}
+
+//streams packed in memory are capped, the least recently used go first, streams mapped from a cache file cost no memory
+void PointCloud::evictPackedStreams(PackedStreamKey const& keep) const
+{
+	auto isPacked = [&](PackedStream const& stream) {
+		return !storageOwner || stream.owner != storageOwner;
+	};
+	std::size_t packedBytes = 0;
+	for(auto const& [key, stream] : packedStreams)
+		packedBytes += isPacked(stream) ? stream.data.size() : 0;
+
+	while(packedBytes > packedStreamBudget)
+	{
+		auto evicted = packedStreams.end();
+		for(auto stream = packedStreams.begin(); stream != packedStreams.end(); ++stream)
+		{
+			if(isPacked(stream->second) && !(stream->first == keep) && (evicted == packedStreams.end() || stream->second.lastUse < evicted->second.lastUse))
+				evicted = stream;
+		}
+		if(evicted == packedStreams.end())
+			return;
+		packedBytes -= evicted->second.data.size();
+		retiredPackedStreams.push_back(std::move(evicted->second.owner));
+		packedStreams.erase(evicted);
+	}
+}
+
+//the renderer packs the stream anew instead
+void PointCloud::rejectPackedStream(PackedStreamKey const& key) const
+{
+	auto stream = packedStreams.find(key);
+	std::cerr << "Cached stream " + key.name + " does not match the cloud, packing it again\n";
+	retiredPackedStreams.push_back(std::move(stream->second.owner));
+	packedStreams.erase(stream);
+}
+
+void PointCloud::clearPackedStreams() const
+{
+	for(auto& [key, stream] : packedStreams)
+		retiredPackedStreams.push_back(std::move(stream.owner));
+	packedStreams.clear();
+}
+
+void PointCloud::releaseRetiredPackedStreams() const
+{
+	retiredPackedStreams.clear();
+}
+
+PointCloudOctree const& PointCloud::getOctree() const
+{
+	if(!octree)
+		octree = std::make_shared<PointCloudOctree const>(*this);
+	return *octree;
 }
 
 glm::vec3 PointCloud::convertToWorldPosition(glm::ivec3 indices, glm::vec3 localPosition) const
@@ -182,26 +493,6 @@ glm::vec3 PointCloud::getOffsetAt(glm::ivec3 indices) const
 std::unique_ptr<PointCloud> PointCloud::decimate(std::size_t maxPoints) const
 {
 	float stride = std::max(1.0f, float(vertexCount) / maxPoints);
-	std::vector<glm::vec3> positions;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::u8vec3> colors;
-
-	positions.reserve(vertexCount);
-	if(hasNormals())
-		normals.reserve(vertexCount);
-	if(hasColors())
-		colors.reserve(vertexCount);
-
-	for(auto const& brick : bricks)
-	{
-		for(auto const& position : brick.positions)
-			positions.push_back(convertToWorldPosition(brick.indices, position));
-		for(auto const& normal : brick.normals)
-			normals.push_back(normal);
-		for(auto const& color : brick.colors)
-			colors.push_back(color);
-	}
-
 	std::vector<glm::vec3> decimatedPositions;
 	std::vector<glm::vec3> decimatedNormals;
 	std::vector<glm::u8vec3> decimatedColors;
@@ -212,13 +503,18 @@ std::unique_ptr<PointCloud> PointCloud::decimate(std::size_t maxPoints) const
 	if(hasColors())
 		decimatedColors.reserve(maxPoints);
 
-	for(float i = 0; i < positions.size(); i += stride)
+	std::size_t brickIndex = 0;
+	glm::ivec3 brickIndices = getBrickIndices(brickIndex, subdivisions);
+	for(float i = 0; i < vertexCount; i += stride)
 	{
-		decimatedPositions.push_back(positions[i]);
+		std::size_t idx = i;
+		while(idx >= brickOffsets[brickIndex + 1])
+			brickIndices = getBrickIndices(++brickIndex, subdivisions);
+		decimatedPositions.push_back(convertToWorldPosition(brickIndices, positions[idx]));
 		if(hasNormals())
-			decimatedNormals.push_back(normals[i]);
+			decimatedNormals.push_back(normals[idx]);
 		if(hasColors())
-			decimatedColors.push_back(colors[i]);
+			decimatedColors.push_back(colors[idx]);
 	}
 	return std::make_unique<PointCloud>(std::move(decimatedPositions), std::move(decimatedNormals), std::move(decimatedColors));
 }
@@ -249,6 +545,21 @@ void PointCloud::drawUI()
 		ImGui::SameLine();
 		drawMemoryConsumption(vertexCount * sizeof(glm::u8vec3));
 	}
+	if(!packedStreams.empty())
+	{
+		std::size_t packedStreamBytes = 0;
+		for(auto const& [key, stream] : packedStreams)
+			packedStreamBytes += stream.data.size();
+		ImGui::Text("    -Packed Streams (%zu) ", packedStreams.size());
+		ImGui::SameLine();
+		drawMemoryConsumption(packedStreamBytes);
+	}
+	if(octree)
+	{
+		ImGui::Text("    -Octree (%zu nodes, depth %u) ", octree->getNodes().size(), octree->getDepth());
+		ImGui::SameLine();
+		drawMemoryConsumption(octree->getMemoryConsumption());
+	}
 
 	switch(brickPrecision)
 	{
@@ -271,8 +582,8 @@ void PointCloud::drawUI()
 	glm::clamp(tmpSubdivisions, glm::ivec3{ 0 }, tmpSubdivisions);
 	if (tmpSubdivisions != subdivisions)
 		setSubDivisions(tmpSubdivisions);
-	ImGui::Text("Total Brick Count: %i", bricks.size());
-	ImGui::Text("Empty Brick Count: %i, (%.2f%%)", emptyBrickCount, 100 * static_cast<float>(emptyBrickCount) / bricks.size());
+	ImGui::Text("Total Brick Count: %i", getBrickCount());
+	ImGui::Text("Empty Brick Count: %i, (%.2f%%)", emptyBrickCount, 100 * static_cast<float>(emptyBrickCount) / getBrickCount());
 
 	static int decimatePointCount = 100'000;
 	ImGui::InputInt("Decimate Max Points: ", &decimatePointCount);
@@ -282,6 +593,11 @@ void PointCloud::drawUI()
 		cloud->setName(getName() + "(decimated)");
 		SceneManager::add(std::make_unique<Scene>(cloud));
 	}
+
+	static char cacheFilename[256] = "cloud.lpc";
+	ImGui::InputText("Brick Cache File", cacheFilename, sizeof(cacheFilename));
+	if(ImGui::Button("Save Brick Cache"))
+		BrickCache::save(*this, cacheFilename);
 }
 
 std::uint32_t packPosition1024(glm::vec3 p)
@@ -323,3 +639,16 @@ std::uint16_t packPosition4(glm::vec3 p)
 	packed |= std::uint16_t(4 * p.z) << 4;
 	return packed;
 }
+
+std::uint32_t encodeMorton(glm::uvec3 cell)
+{
+	auto spreadBits = [](std::uint32_t value) {
+		value &= 0x3FF;
+		value = (value | value << 16) & 0x030000FF;
+		value = (value | value << 8) & 0x0300F00F;
+		value = (value | value << 4) & 0x030C30C3;
+		value = (value | value << 2) & 0x09249249;
+		return value;
+	};
+	return spreadBits(cell.x) | spreadBits(cell.y) << 1 | spreadBits(cell.z) << 2;
+}
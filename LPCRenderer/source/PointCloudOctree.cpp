@@ -0,0 +1,228 @@
+#include "PointCloudOctree.h"
+#include "PointCloud.h"
+#include "Frustum.h"
+#include "NormalEncoding.h"
+#include "GPUBuffer.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <queue>
+
+std::pair<glm::vec3, glm::vec3> PointCloudOctreeNode::getBounds() const
+{
+	return {origin, origin + size};
+}
+
+PointCloudOctree::PointCloudOctree(PointCloud const& cloud)
+{
+	std::size_t pointCount = cloud.getPositions().size();
+	auto brickOffsets = cloud.getBrickOffsets();
+
+	//bricks only know their points relative to themselves, the octree needs them in one common space
+	std::vector<glm::vec3> worldPositions(pointCount);
+	parallelFor(getWorkerCount(), cloud.getBrickCount(), [&](std::size_t, std::size_t begin, std::size_t end) {
+		for(std::size_t brickIndex = begin; brickIndex < end; brickIndex++)
+		{
+			PointCloudBrick brick = cloud.getBrickAt(brickIndex);
+			for(std::size_t point = 0; point < brick.positions.size(); point++)
+				worldPositions[brickOffsets[brickIndex] + point] = cloud.convertToWorldPosition(brick.indices, brick.positions[point]);
+		}
+	});
+
+	std::vector<std::uint32_t> order(pointCount);
+	std::iota(order.begin(), order.end(), 0);
+
+	//while building, offset and count cover the points of the whole subtree
+	PointCloudOctreeNode root;
+	glm::vec3 cloudSize = cloud.getSize();
+	root.origin = cloud.getBounds().first;
+	root.size = std::max({cloudSize.x, cloudSize.y, cloudSize.z, std::numeric_limits<float>::min()});
+	root.count = pointCount;
+	nodes.push_back(root);
+
+	auto getCellIndex = [&](PointCloudOctreeNode const& node, glm::vec3 position) {
+		glm::ivec3 cell = glm::clamp(glm::ivec3((position - node.origin) / node.spacing), glm::ivec3(0), glm::ivec3(samplingGridSize - 1));
+		return (std::size_t(cell.z) * samplingGridSize + cell.y) * samplingGridSize + cell.x;
+	};
+
+	//keeps the first point of every occupied grid cell and buckets the rest by octant right behind them
+	auto split = [&](PointCloudOctreeNode& node, std::array<std::size_t, 8>& childCounts, std::vector<std::uint8_t>& occupied, std::vector<std::uint32_t>& rest) {
+		node.spacing = node.size / samplingGridSize;
+		childCounts.fill(0);
+		if(node.count <= maxLeafPointCount || node.depth == maxDepth)
+			return;
+
+		std::uint32_t* range = order.data() + node.offset;
+		std::size_t keptCount = 0;
+		rest.clear();
+		for(std::size_t point = 0; point < node.count; point++)
+		{
+			std::size_t cellIndex = getCellIndex(node, worldPositions[range[point]]);
+			if(occupied[cellIndex])
+			{
+				rest.push_back(range[point]);
+				continue;
+			}
+			occupied[cellIndex] = 1;
+			range[keptCount++] = range[point];
+		}
+		//only the kept points touched the grid, so clearing them is cheaper than clearing the whole grid
+		for(std::size_t point = 0; point < keptCount; point++)
+			occupied[getCellIndex(node, worldPositions[range[point]])] = 0;
+
+		glm::vec3 center = node.origin + 0.5f * node.size;
+		auto getOctant = [&](std::uint32_t point) {
+			glm::vec3 position = worldPositions[point];
+			return int(position.x >= center.x) | int(position.y >= center.y) << 1 | int(position.z >= center.z) << 2;
+		};
+		for(auto point : rest)
+			childCounts[getOctant(point)]++;
+		std::array<std::size_t, 8> cursors;
+		cursors[0] = keptCount;
+		for(int octant = 1; octant < 8; octant++)
+			cursors[octant] = cursors[octant - 1] + childCounts[octant - 1];
+		for(auto point : rest)
+			range[cursors[getOctant(point)]++] = point;
+		node.count = keptCount;
+	};
+
+	//level by level, the nodes of one level own disjoint ranges of order and can be split in parallel
+	std::size_t levelBegin = 0;
+	while(levelBegin < nodes.size())
+	{
+		std::size_t levelEnd = nodes.size();
+		std::vector<std::array<std::size_t, 8>> childCounts(levelEnd - levelBegin);
+		parallelFor(getWorkerCount(), levelEnd - levelBegin, [&](std::size_t, std::size_t begin, std::size_t end) {
+			std::vector<std::uint8_t> occupied(std::size_t(samplingGridSize) * samplingGridSize * samplingGridSize, 0);
+			std::vector<std::uint32_t> rest;
+			for(std::size_t node = begin; node < end; node++)
+				split(nodes[levelBegin + node], childCounts[node], occupied, rest);
+		});
+
+		for(std::size_t nodeIndex = levelBegin; nodeIndex < levelEnd; nodeIndex++)
+		{
+			PointCloudOctreeNode parent = nodes[nodeIndex];
+			parent.firstChild = nodes.size();
+			std::size_t childOffset = parent.offset + parent.count;
+			for(int octant = 0; octant < 8; octant++)
+			{
+				std::size_t childCount = childCounts[nodeIndex - levelBegin][octant];
+				if(childCount == 0)
+					continue;
+				PointCloudOctreeNode child;
+				child.size = 0.5f * parent.size;
+				child.origin = parent.origin + child.size * glm::vec3(octant & 1, (octant >> 1) & 1, (octant >> 2) & 1);
+				child.depth = parent.depth + 1;
+				child.offset = childOffset;
+				child.count = childCount;
+				childOffset += childCount;
+				nodes.push_back(child);
+				parent.childCount++;
+				parent.childMask |= 1 << octant;
+				depth = std::max(depth, child.depth);
+			}
+			nodes[nodeIndex] = parent;
+		}
+		levelBegin = levelEnd;
+	}
+
+	sortPoints(cloud, worldPositions, order);
+}
+
+void PointCloudOctree::sortPoints(PointCloud const& cloud, std::vector<glm::vec3> const& worldPositions, std::vector<std::uint32_t> const& order)
+{
+	positions.resize(order.size());
+	if(cloud.hasNormals())
+		normals.resize(order.size());
+	if(cloud.hasColors())
+		colors.resize(order.size());
+
+	parallelFor(getWorkerCount(), nodes.size(), [&](std::size_t, std::size_t begin, std::size_t end) {
+		for(std::size_t nodeIndex = begin; nodeIndex < end; nodeIndex++)
+		{
+			PointCloudOctreeNode const& node = nodes[nodeIndex];
+			for(std::size_t idx = node.offset; idx < node.offset + node.count; idx++)
+			{
+				std::uint32_t point = order[idx];
+				//points on the upper bounds would wrap around once quantized
+				positions[idx] = packPosition1024(glm::clamp((worldPositions[point] - node.origin) / node.size, 0.0f, std::nextafter(1.0f, 0.0f)));
+				if(!normals.empty())
+					normals[idx] = static_cast<std::uint16_t>(toOctahedral(cloud.getNormals()[point], normalComponentBits));
+				if(!colors.empty())
+					colors[idx] = cloud.getColors()[point];
+			}
+		}
+	});
+}
+
+std::size_t PointCloudOctree::selectNodes(glm::mat4 const& modelViewProjection, glm::vec3 cameraPosition, float projectionScale,
+	float maxScreenError, std::size_t pointBudget, std::vector<std::uint32_t>& selection) const
+{
+	selection.clear();
+	if(nodes.empty())
+		return 0;
+
+	//how far apart the samples of a node appear on screen, measured from the closest point of its bounding sphere
+	auto getScreenError = [&](PointCloudOctreeNode const& node) {
+		float distance = glm::distance(cameraPosition, node.origin + 0.5f * node.size) - 0.5f * std::sqrt(3.0f) * node.size;
+		if(distance <= 0.0f)
+			return std::numeric_limits<float>::max();
+		return node.spacing * projectionScale / distance;
+	};
+
+	std::priority_queue<std::pair<float, std::uint32_t>> candidates;
+	candidates.emplace(std::numeric_limits<float>::max(), 0);
+	std::size_t pointCount = 0;
+	while(!candidates.empty())
+	{
+		std::uint32_t nodeIndex = candidates.top().second;
+		candidates.pop();
+		PointCloudOctreeNode const& node = nodes[nodeIndex];
+		if(isOutsideFrustum(modelViewProjection, node.getBounds()))
+			continue;
+		if(pointCount + node.count > pointBudget)
+			break;
+		pointCount += node.count;
+		selection.push_back(nodeIndex);
+
+		if(getScreenError(node) <= maxScreenError)
+			continue;
+		for(std::uint32_t child = node.firstChild; child < node.firstChild + node.childCount; child++)
+			candidates.emplace(getScreenError(nodes[child]), child);
+	}
+	return pointCount;
+}
+
+Span<PointCloudOctreeNode const> PointCloudOctree::getNodes() const
+{
+	return {nodes.data(), nodes.size()};
+}
+
+Span<std::uint32_t const> PointCloudOctree::getPositions() const
+{
+	return {positions.data(), positions.size()};
+}
+
+Span<std::uint16_t const> PointCloudOctree::getNormals() const
+{
+	return {normals.data(), normals.size()};
+}
+
+Span<glm::u8vec3 const> PointCloudOctree::getColors() const
+{
+	return {colors.data(), colors.size()};
+}
+
+std::uint32_t PointCloudOctree::getDepth() const
+{
+	return depth;
+}
+
+std::size_t PointCloudOctree::getMemoryConsumption() const
+{
+	return sizeInBytes(nodes) + sizeInBytes(positions) + sizeInBytes(normals) + sizeInBytes(colors);
+}
@@ -2,15 +2,27 @@
 #include "glad/glad.h"
 #include "imgui.h"
 #include "glm/glm.hpp"
+#include "GPUBuffer.h"
 
+#include <cfloat>
 #include <chrono>
 #include <array>
 #include <vector>
 #include <numeric>
 #include <string>
 
+#ifdef _WIN32
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#include <fstream>
+#endif
+
 using namespace std::literals::chrono_literals;
 
+static void recordStreamingFrame();
+
 //TIME
 static const int frameSamples = 200;
 static unsigned int currentFrameIndex = 0;
@@ -48,6 +60,8 @@ void Profiler::recordFrame()
 	updateStats(currentFenceWaitDuration, averageFenceWaitDuration, longestFenceWaitDuration, 5ms, fenceWaitDurations);
 	currentFenceWaitDuration = 0ns;
 
+	recordStreamingFrame();
+
 }
 
 void Profiler::beginFenceWait()
@@ -85,6 +99,88 @@ void Profiler::recordGPUDeallocation(std::size_t size)
 	updateAllocatedSizes();
 }
 
+std::size_t Profiler::getGPUAllocatedBytes()
+{
+	return allocatedBytes;
+}
+
+std::size_t Profiler::getResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize;
+#else
+	std::size_t totalPages = 0;
+	std::size_t residentPages = 0;
+	std::ifstream statm{"/proc/self/statm"};
+	statm >> totalPages >> residentPages;
+	return residentPages * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+//STREAMING
+struct StreamingFrame
+{
+	std::size_t pageIns = 0;
+	std::size_t pageInBytes = 0;
+	std::size_t uploadBytes = 0;
+	std::size_t hostEvictions = 0;
+	std::size_t gpuEvictions = 0;
+};
+static std::array<StreamingFrame, frameSamples> streamingFrames;
+static StreamingFrame currentStreamingFrame;
+static StreamingFrame totalStreaming;
+static std::size_t residentHostBytes = 0;
+static std::size_t residentHostBudget = 0;
+static std::size_t residentGPUBytes = 0;
+static std::size_t residentGPUBudget = 0;
+static bool streamingActive = false;
+
+static void recordStreamingFrame()
+{
+	streamingFrames[currentFrameIndex] = currentStreamingFrame;
+	currentStreamingFrame = {};
+}
+
+void Profiler::recordBrickPageIn(std::size_t size)
+{
+	currentStreamingFrame.pageIns++;
+	currentStreamingFrame.pageInBytes += size;
+	totalStreaming.pageIns++;
+	totalStreaming.pageInBytes += size;
+}
+
+void Profiler::recordBrickUpload(std::size_t size)
+{
+	currentStreamingFrame.uploadBytes += size;
+	totalStreaming.uploadBytes += size;
+}
+
+void Profiler::recordBrickEviction(bool fromGPU)
+{
+	if(fromGPU)
+	{
+		currentStreamingFrame.gpuEvictions++;
+		totalStreaming.gpuEvictions++;
+	}
+	else
+	{
+		currentStreamingFrame.hostEvictions++;
+		totalStreaming.hostEvictions++;
+	}
+}
+
+void Profiler::recordBrickResidency(std::size_t hostBytes, std::size_t hostBudget, std::size_t gpuBytes, std::size_t gpuBudget)
+{
+	streamingActive = gpuBudget != 0;
+	residentHostBytes = hostBytes;
+	residentHostBudget = hostBudget;
+	residentGPUBytes = gpuBytes;
+	residentGPUBudget = gpuBudget;
+}
+
 template<typename T, typename Ratio>
 std::string printDuration(std::chrono::duration<T, Ratio> duration)
 {
@@ -128,13 +224,13 @@ void Profiler::drawUI()
 				return reinterpret_cast<std::chrono::nanoseconds*>(data)[idx].count();
 		},frametimes.data(), frameSamples, currentFrameIndex, nullptr, 0.0f, longestFrametime.count(), {ImGui::GetContentRegionAvailWidth(), plotHeight});
 
-		/*ImGui::NewLine();
+		ImGui::NewLine();
 		ImGui::Text("Time Waiting On Fences: %s", printDuration(fenceWaitDurations[currentFrameIndex]).data());
 		ImGui::Text("Average: %s", printDuration(averageFenceWaitDuration).data());
 		ImGui::Text("Longest: %s", printDuration(longestFenceWaitDuration).data());
 		ImGui::PlotLines("###FenceWaitDuration", [](void* data, int idx) -> float{
 			return reinterpret_cast<std::chrono::nanoseconds*>(data)[idx].count();
-		}, fenceWaitDurations.data(), frameSamples, currentFrameIndex, nullptr, 0.0f, longestFenceWaitDuration.count(), {ImGui::GetContentRegionAvailWidth(), plotHeight});*/
+		}, fenceWaitDurations.data(), frameSamples, currentFrameIndex, nullptr, 0.0f, longestFenceWaitDuration.count(), {ImGui::GetContentRegionAvailWidth(), plotHeight});
 	}
 
 	ImGui::NewLine();
@@ -161,6 +257,45 @@ void Profiler::drawUI()
 		}
 	}
 
+	if(streamingActive)
+	{
+		ImGui::NewLine();
+		if(ImGui::CollapsingHeader("Brick Streaming", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			static float const plotHeight = 50;
+			ImGui::Text("Host Working Set: ");
+			ImGui::SameLine();
+			drawMemoryConsumption(residentHostBytes);
+			ImGui::SameLine();
+			ImGui::Text("/ ");
+			ImGui::SameLine();
+			drawMemoryConsumption(residentHostBudget);
+			ImGui::Text("GPU Brick Pool: ");
+			ImGui::SameLine();
+			drawMemoryConsumption(residentGPUBytes);
+			ImGui::SameLine();
+			ImGui::Text("/ ");
+			ImGui::SameLine();
+			drawMemoryConsumption(residentGPUBudget);
+			ImGui::Text("Page-ins: %zu (", totalStreaming.pageIns);
+			ImGui::SameLine();
+			drawMemoryConsumption(totalStreaming.pageInBytes);
+			ImGui::SameLine();
+			ImGui::Text(")");
+			ImGui::Text("Uploaded: ");
+			ImGui::SameLine();
+			drawMemoryConsumption(totalStreaming.uploadBytes);
+			ImGui::Text("Evictions: %zu host, %zu GPU", totalStreaming.hostEvictions, totalStreaming.gpuEvictions);
+			ImGui::PlotHistogram("###PageIns", [](void* data, int idx) -> float{
+				return reinterpret_cast<StreamingFrame*>(data)[idx].pageIns;
+			}, streamingFrames.data(), frameSamples, currentFrameIndex, "Page-ins per frame", FLT_MAX, FLT_MAX, {ImGui::GetContentRegionAvailWidth(), plotHeight});
+			ImGui::PlotHistogram("###Evictions", [](void* data, int idx) -> float{
+				auto const& frame = reinterpret_cast<StreamingFrame*>(data)[idx];
+				return frame.hostEvictions + frame.gpuEvictions;
+			}, streamingFrames.data(), frameSamples, currentFrameIndex, "Evictions per frame", FLT_MAX, FLT_MAX, {ImGui::GetContentRegionAvailWidth(), plotHeight});
+		}
+	}
+
 	ImGui::NewLine();
 	static bool showContextInfo = false;
 	if(ImGui::Button("GL Context"))
@@ -0,0 +1,61 @@
+#include "ThreadPool.h"
+#include "Parallel.h"
+
+ThreadPool::ThreadPool(std::size_t workerCount)
+{
+	for(std::size_t i = 0; i < workerCount; i++)
+		workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock{tasksMutex};
+		stopping = true;
+	}
+	tasksAvailable.notify_all();
+	for(auto& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::work()
+{
+	while(true)
+	{
+		std::packaged_task<void()> task;
+		{
+			std::unique_lock lock{tasksMutex};
+			tasksAvailable.wait(lock, [&]() {
+				return stopping || !tasks.empty();
+			});
+			if(tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+		task();
+	}
+}
+
+std::size_t ThreadPool::getWorkerCount() const
+{
+	return workers.size();
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task)
+{
+	std::packaged_task<void()> packagedTask{std::move(task)};
+	std::future<void> result = packagedTask.get_future();
+	{
+		std::lock_guard lock{tasksMutex};
+		tasks.push(std::move(packagedTask));
+	}
+	tasksAvailable.notify_one();
+	return result;
+}
+
+ThreadPool& getWorkerPool()
+{
+	static ThreadPool pool{std::max<std::size_t>(1, getWorkerCount() - 1)};
+	return pool;
+}
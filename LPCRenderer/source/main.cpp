@@ -7,6 +7,7 @@
 #include "PCManager.h"
 #include "SceneManager.h"
 #include "Importer.h"
+#include "Benchmark.h"
 
 #include <vector>
 #include <memory>
@@ -23,6 +24,7 @@ int main(int argc, char** argv)
 		OSWindow::beginFrame();
 
 		Profiler::recordFrame();
+		Importer::update();
 		MainRenderer::render(SceneManager::getActive());
 		drawUI();
 
@@ -41,7 +43,9 @@ void drawUI()
 		UIWindow{"Profiler", Profiler::drawUI, true, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_AlwaysAutoResize},
 		UIWindow{"Renderer", MainRenderer::drawUI, true},
 		UIWindow{SceneManager::name, SceneManager::drawUI, true},
-		UIWindow{PCManager::name, PCManager::drawUI, true}
+		UIWindow{PCManager::name, PCManager::drawUI, true},
+		UIWindow{"Import", Importer::drawUI, true},
+		UIWindow{"Benchmark", Benchmark::drawUI}
 	};
 
 	if(ImGui::BeginMainMenuBar())